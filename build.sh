@@ -4,7 +4,8 @@
 set -euo pipefail
 
 EX_DIR="${1:?Pass the example directory (e.g., examples/square)}"
-SRC="$EX_DIR/main.c"
+SRC=("$EX_DIR"/*.c(N))          # every source file of the example
+SRC=(${SRC:#*/check.c})          # but the headless check, which has its own main()
 OUT_JS="$EX_DIR/index.js"
 
 # Defaults (can be overridden by env)
@@ -17,18 +18,38 @@ if [[ -d "$EX_DIR/assets" ]]; then
   ASSETS_ARGS+=(--preload-file "$EX_DIR/assets@/assets" -s FILESYSTEM=1 --use-preload-plugins)
 fi
 
-echo "[build $(date '+%H:%M:%S')] $SRC → $OUT_JS"
-emcc "$SRC" \
+# PTHREADS=1 builds with wasm threads (SharedArrayBuffer) so the ball sim can use
+# its worker pool. Needs a raylib lib built with -pthread and a server sending
+# COOP/COEP headers; the default build stays single-threaded.
+ENVIRONMENT=web
+THREAD_ARGS=()
+if [[ "${PTHREADS:-0}" == "1" ]]; then
+  ENVIRONMENT=web,worker
+  THREAD_ARGS+=(-pthread -s PTHREAD_POOL_SIZE="${PTHREAD_POOL_SIZE:-7}")
+fi
+
+# SIMD=1 builds with wasm SIMD128, which cocosoap's 4-lane narrowphase and
+# auto-vectorized loops use. Browsers without wasm SIMD refuse to load such a
+# module, so it is opt-in; without it cocosoap falls back to scalar lanes.
+SIMD_ARGS=()
+if [[ "${SIMD:-0}" == "1" ]]; then
+  SIMD_ARGS+=(-msimd128)
+fi
+
+echo "[build $(date '+%H:%M:%S')] ${SRC[*]} → $OUT_JS"
+emcc "${SRC[@]}" \
   -o "$OUT_JS" \
   -I"$RAYLIB_INCLUDE" "$RAYLIB_WEB_LIB" \
   -DPLATFORM_WEB \
   -s WASM=1 \
   -s MODULARIZE=1 \
   -s EXPORT_ES6=1 \
-  -s ENVIRONMENT=web \
+  -s ENVIRONMENT="$ENVIRONMENT" \
   -s ALLOW_MEMORY_GROWTH=1 \
   -s ASYNCIFY \
   -s USE_GLFW=3 \
+  "${SIMD_ARGS[@]}" \
+  "${THREAD_ARGS[@]}" \
   "${ASSETS_ARGS[@]}" \
   -O2
 echo "[done  $(date '+%H:%M:%S')] wrote $OUT_JS and ${OUT_JS%.js}.wasm"
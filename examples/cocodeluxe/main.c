@@ -2,6 +2,7 @@
 #include "raylib.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef PLATFORM_WEB
 #include <emscripten/emscripten.h>
@@ -12,6 +13,9 @@
 #define DEBUG_DRAW        0
 #define SHAPE_SHAPE_PUSH  1
 #define ROTATE_TEXTURES   1   // twist / right-drag rotates (squares = geom, circles = texture)
+#define TEXTURE_SDF       1   // textured shapes collide with their image silhouette (SDF baked from alpha)
+#define DEPENETRATE       1   // trapped balls are pushed out along the shape's distance gradient; respawn is the fallback
+#define KINEMATIC_SHAPES  1   // dragged/pinched/twisted shapes carry their velocity: moving-wall bounces, swept plowing
 // -------------------------------------------
 
 // ---------------- Tunables -----------------
@@ -30,7 +34,12 @@ static const float CIRCLE_R_MIN    = 20.0f;
 static const float CIRCLE_R_MAX    = 300.0f;
 
 static const float SPAWN_MARGIN         = 6.0f;
+static const int   SDF_RES              = 64;     // silhouette SDF cells on the texture's long side
+static const int   SDF_ALPHA_CUT        = 128;    // mean alpha at or above this is solid
 static const int   MAX_SUBSTEPS         = 2;
+static const int   DEPEN_ITERS          = 3;      // pushes per trapped ball before it is respawned instead
+static const int   PLOW_MARCH_STEPS     = 24;     // distance-marching steps per moving-shape sweep
+static const float KICK_MAX_SPEED       = 60.0f;  // px/s; moving shapes never bat balls faster
 static const float SEP_BIAS             = 0.50f;
 static const float TOUCH_DELTA_DEADZONE = 0.5f;
 // -------------------------------------------
@@ -93,6 +102,156 @@ static const ShapeInit SHAPES_PRESET[NUM_SHAPES] = {
 };
 // ================= END CONFIG BLOCK =================
 
+// ----- Texture silhouette SDF -----
+// Each texture's alpha is baked at load into a coarse signed distance field:
+// SDF_RES cells on the long side plus a transparent one-cell border, solid
+// where the cell's mean alpha reaches SDF_ALPHA_CUT. Distances come from the
+// linear-time squared Euclidean transform (Felzenszwalb & Huttenlocher), run
+// over columns then rows, once to the solid cells and once to the clear ones.
+#define SDF_FAR 1e20f
+
+typedef struct {
+    int    w, h;        // cells; 0 if the texture has no solid pixels
+    float  cellPx;      // texture px per cell
+    float  ox, oy;      // grid position of the texture centre, in cells
+    float  reach;       // farthest solid point from the texture centre, in cells
+    float *d;           // w*h signed distances in cells, negative inside
+} TexSdf;
+
+static TexSdf gTexSdf[TEX_COUNT] = {0};
+
+// Lower envelope of the parabolas (q - p)^2 + f[p]: d[q] = min_p of that.
+static void Edt1D(const float *f, float *d, int *v, float *z, int n){
+    int k = 0;
+    v[0] = 0; z[0] = -SDF_FAR; z[1] = SDF_FAR;
+    for (int q=1;q<n;++q){
+        float s;
+        for (;;){
+            int p = v[k];
+            s = ((f[q] + (float)(q*q)) - (f[p] + (float)(p*p))) / (float)(2*(q - p));
+            if (s > z[k]) break;
+            --k;
+        }
+        ++k; v[k] = q; z[k] = s; z[k+1] = SDF_FAR;
+    }
+    k = 0;
+    for (int q=0;q<n;++q){
+        while (z[k+1] < (float)q) ++k;
+        float t = (float)(q - v[k]);
+        d[q] = t*t + f[v[k]];
+    }
+}
+
+// In place over a w*h grid of 0 (seed) / SDF_FAR values.
+static void Edt2D(float *g, int w, int h, float *f, float *d, int *v, float *z){
+    for (int x=0;x<w;++x){
+        for (int y=0;y<h;++y) f[y] = g[y*w + x];
+        Edt1D(f, d, v, z, h);
+        for (int y=0;y<h;++y) g[y*w + x] = d[y];
+    }
+    for (int y=0;y<h;++y){
+        memcpy(f, g + y*w, sizeof(float) * w);
+        Edt1D(f, g + y*w, v, z, w);
+    }
+}
+
+static void TexSdfFree(TexSdf *s){
+    free(s->d);
+    *s = (TexSdf){0};
+}
+
+static int TexSdfBake(TexSdf *s, Image *img){
+    const int SS = 4;   // alpha samples per cell side
+    TexSdfFree(s);
+    if (!img->data || img->width <= 0 || img->height <= 0) return 0;
+    if (img->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) ImageFormat(img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    const unsigned char *px = (const unsigned char*)img->data;
+    const int W = img->width, H = img->height;
+    const float cellPx = (float)((W > H) ? W : H) / (float)SDF_RES;
+    const int iw = (int)ceilf((float)W / cellPx), ih = (int)ceilf((float)H / cellPx);
+    const int w = iw + 2, h = ih + 2, m = (w > h) ? w : h;
+
+    float *out = (float*)malloc(sizeof(float) * w * h);   // squared distance to solid
+    float *in  = (float*)malloc(sizeof(float) * w * h);   // squared distance to clear
+    float *f   = (float*)malloc(sizeof(float) * m);
+    float *d   = (float*)malloc(sizeof(float) * m);
+    float *z   = (float*)malloc(sizeof(float) * (m + 1));
+    int   *v   = (int*)malloc(sizeof(int) * m);
+    if (!out || !in || !f || !d || !z || !v){ free(out); free(in); free(f); free(d); free(z); free(v); return 0; }
+
+    int nSolid = 0;
+    for (int cy=0; cy<h; ++cy){
+        for (int cx=0; cx<w; ++cx){
+            int solid = 0;
+            if (cx > 0 && cy > 0 && cx <= iw && cy <= ih){
+                int sum = 0;
+                for (int sy=0; sy<SS; ++sy){
+                    int ty = (int)(((float)(cy - 1) + ((float)sy + 0.5f) / SS) * cellPx);
+                    if (ty > H - 1) ty = H - 1;
+                    const unsigned char *row = px + (size_t)ty * W * 4 + 3;
+                    for (int sx=0; sx<SS; ++sx){
+                        int tx = (int)(((float)(cx - 1) + ((float)sx + 0.5f) / SS) * cellPx);
+                        if (tx > W - 1) tx = W - 1;
+                        sum += row[(size_t)tx * 4];
+                    }
+                }
+                solid = (sum >= SDF_ALPHA_CUT * SS * SS);
+            }
+            out[cy*w + cx] = solid ? 0.0f : SDF_FAR;
+            in [cy*w + cx] = solid ? SDF_FAR : 0.0f;
+            nSolid += solid;
+        }
+    }
+    if (nSolid == 0){ free(out); free(in); free(f); free(d); free(z); free(v); return 0; }
+
+    Edt2D(out, w, h, f, d, v, z);
+    Edt2D(in,  w, h, f, d, v, z);
+
+    s->w = w; s->h = h; s->cellPx = cellPx;
+    s->ox = 1.0f + 0.5f * (float)W / cellPx;
+    s->oy = 1.0f + 0.5f * (float)H / cellPx;
+    float reach2 = 0.0f;
+    for (int cy=0; cy<h; ++cy){
+        for (int cx=0; cx<w; ++cx){
+            int i = cy*w + cx;
+            if (out[i] == 0.0f){
+                out[i] = 0.5f - sqrtf(in[i]);   // the edge sits half a cell out from the last solid centre
+                float dx = (float)cx + 0.5f - s->ox, dy = (float)cy + 0.5f - s->oy;
+                if (dx*dx + dy*dy > reach2) reach2 = dx*dx + dy*dy;
+            } else {
+                out[i] = sqrtf(out[i]) - 0.5f;
+            }
+        }
+    }
+    s->reach = sqrtf(reach2) + 0.70710678f;
+    s->d = out;
+    free(in); free(f); free(d); free(z); free(v);
+    return 1;
+}
+
+// Distance (cells) at (u, v) cells from the texture centre, bilinear, with
+// its unnormalised gradient. Past the grid, the distance to the grid edge is
+// added on; the border ring is clear, so this only grows away from the shape.
+static inline float TexSdfSample(const TexSdf *s, float u, float v, float *gx, float *gy){
+    const float fx = u + s->ox - 0.5f, fy = v + s->oy - 0.5f;
+    const float mx = (float)(s->w - 1) - 1e-3f, my = (float)(s->h - 1) - 1e-3f;
+    const float cx = (fx < 0.0f) ? 0.0f : (fx > mx) ? mx : fx;
+    const float cy = (fy < 0.0f) ? 0.0f : (fy > my) ? my : fy;
+    const int   x0 = (int)cx, y0 = (int)cy;
+    const float tx = cx - (float)x0, ty = cy - (float)y0;
+    const float *r0 = s->d + y0*s->w + x0, *r1 = r0 + s->w;
+    const float top = r0[0] + (r0[1] - r0[0])*tx, bot = r1[0] + (r1[1] - r1[0])*tx;
+    const float dist = top + (bot - top)*ty;
+    const float ex = fx - cx, ey = fy - cy;
+    if (ex != 0.0f || ey != 0.0f){
+        *gx = ex; *gy = ey;
+        return dist + sqrtf(ex*ex + ey*ey);
+    }
+    *gx = (r0[1] - r0[0]) + ((r1[1] - r1[0]) - (r0[1] - r0[0]))*ty;
+    *gy = bot - top;
+    return dist;
+}
+
 // ----- Texture bank (optional) -----
 static Texture2D gTextures[TEX_COUNT] = {0};
 static int gTexLoaded = 0;
@@ -102,12 +261,29 @@ static inline int TextureIndexOk(int idx){ return (idx >= 0 && idx < TEX_COUNT &
 
 static void LoadTextureBank(void){
     if (gTexLoaded) return;
+#if TEXTURE_SDF
+    int nBaked = 0;
+    double bakeMs = 0.0;
+#endif
     for (int i=0;i<TEX_COUNT;++i){
         if (FileExists(TEX_PATHS[i])){
+#if TEXTURE_SDF
+            // Decode once: the same pixels feed the texture and the silhouette bake.
+            Image img = LoadImage(TEX_PATHS[i]);
+            gTextures[i] = LoadTextureFromImage(img);
+            double t0 = GetTime();
+            nBaked += TexSdfBake(&gTexSdf[i], &img);
+            bakeMs += (GetTime() - t0) * 1e3;
+            UnloadImage(img);
+#else
             gTextures[i] = LoadTexture(TEX_PATHS[i]);
+#endif
             if (TextureOk(gTextures[i])) SetTextureFilter(gTextures[i], TEXTURE_FILTER_BILINEAR);
         }
     }
+#if TEXTURE_SDF
+    TraceLog(LOG_INFO, "SDF: baked %d silhouettes (%d cells on the long side) in %.2f ms", nBaked, SDF_RES, bakeMs);
+#endif
     gTexLoaded = 1;
 }
 static void UnloadTextureBank(void){
@@ -115,6 +291,7 @@ static void UnloadTextureBank(void){
     for (int i=0;i<TEX_COUNT;++i){
         if (TextureOk(gTextures[i])) UnloadTexture(gTextures[i]);
         gTextures[i] = (Texture2D){0};
+        TexSdfFree(&gTexSdf[i]);
     }
     gTexLoaded = 0;
 }
@@ -132,6 +309,8 @@ typedef struct {
     int   texId;    // -1 = no texture; else index into gTextures[]
     TexFit fit;     // scaling mode
     Color tint;     // tint for texture
+    float vx, vy, w, grow;   // surface motion this frame: px/s, rad/s and scale rate (1/s) about the centre
+    float mx, my;            // travel this frame
 } Shape;
 
 typedef struct { int id; Vector2 pos; } TrackedTouch;
@@ -285,10 +464,64 @@ static int TopShapeAt(float px, float py, const Shape *shapes, int count){
 static inline float ShapeHullRadius(const Shape *sh){
     return (sh->type==SHAPE_SQUARE)? (sh->half*1.41421356237f) : sh->radius;
 }
+
+// Scale and rotation DrawShapeWithTexture puts on the shape's texture.
+static inline float TextureDrawScale(const Shape *sh, Texture2D tex){
+    float side = (sh->type == SHAPE_SQUARE) ? sh->half * 2.0f : sh->radius * 2.0f;
+    float sx = side / (float)tex.width, sy = side / (float)tex.height;
+    return (sh->fit == TEX_FIT_COVER) ? fmaxf(sx, sy) : fminf(sx, sy);
+}
+static inline float TextureDrawAngle(const Shape *sh){
+    return (sh->type == SHAPE_SQUARE || ROTATE_TEXTURES) ? sh->angle : 0.0f;
+}
+
+// Silhouette the shape collides with, placed as drawn (scale = world px per
+// cell), or NULL when it collides with its plain outline.
+static inline const TexSdf *ShapeSdf(const Shape *sh, float *scale){
+#if TEXTURE_SDF
+    if (TextureIndexOk(sh->texId) && gTexSdf[sh->texId].w > 0){
+        *scale = gTexSdf[sh->texId].cellPx * TextureDrawScale(sh, gTextures[sh->texId]);
+        return &gTexSdf[sh->texId];
+    }
+#endif
+    (void)sh; *scale = 0.0f;
+    return NULL;
+}
+
+// Signed distance (px) to the silhouette, with the outward world normal.
+static inline float ShapeSdfDistance(const Shape *sh, const TexSdf *sd, float scale, float px, float py,
+                                     float *nx, float *ny){
+    const float PI_F = 3.14159265358979323846f;
+    float a = TextureDrawAngle(sh)*(PI_F/180.0f), c=cosf(a), s=sinf(a);
+    Vector2 pl = InvRotateCS((Vector2){ px - sh->x, py - sh->y }, c, s);
+    float gx, gy;
+    float d = TexSdfSample(sd, pl.x / scale, pl.y / scale, &gx, &gy) * scale;
+    float gl = gx*gx + gy*gy;
+    if (gl < 1e-12f){ gx = pl.x; gy = pl.y; gl = gx*gx + gy*gy; }   // flat spot: push away from the centre
+    if (gl < 1e-12f){ gx = 1.0f; gy = 0.0f; gl = 1.0f; }
+    gl = 1.0f / sqrtf(gl);
+    Vector2 n = RotateCS((Vector2){ gx*gl, gy*gl }, c, s);
+    *nx = n.x; *ny = n.y;
+    return d;
+}
+
+// What balls collide with: the silhouette when there is one, else the outline.
+static inline float ShapeCollideRadius(const Shape *sh){
+    float scale;
+    const TexSdf *sd = ShapeSdf(sh, &scale);
+    return sd ? sd->reach * scale : ShapeHullRadius(sh);
+}
+static inline int PointInShapeSolid(float px, float py, const Shape *sh){
+    float scale, nx, ny;
+    const TexSdf *sd = ShapeSdf(sh, &scale);
+    if (!sd) return PointInShape(px, py, sh);
+    float dx = px - sh->x, dy = py - sh->y, reach = sd->reach * scale;
+    return (dx*dx + dy*dy <= reach*reach) && ShapeSdfDistance(sh, sd, scale, px, py, &nx, &ny) <= 0.0f;
+}
 static inline void PushOutsideHull(const Shape *sh, float r, float *bx, float *by){
     float dx = *bx - sh->x, dy = *by - sh->y;
     float len2 = dx*dx + dy*dy;
-    float minD = ShapeHullRadius(sh) + r + SPAWN_MARGIN;
+    float minD = ShapeCollideRadius(sh) + r + SPAWN_MARGIN;
     float minD2 = minD*minD;
     if (len2 < 1e-8f){ dx=1.0f; dy=0.0f; len2=1.0f; }
     if (len2 < minD2){
@@ -312,7 +545,7 @@ static inline void AssignBallKinematicsAndColor(Ball *b){
 }
 
 static int CenterInsideAnyShape(const Shape *shapes, int n, float px, float py){
-    for (int i=0;i<n;++i) if (PointInShape(px, py, &shapes[i])) return 1;
+    for (int i=0;i<n;++i) if (PointInShapeSolid(px, py, &shapes[i])) return 1;
     return 0;
 }
 
@@ -328,7 +561,7 @@ static void RespawnBallOutsideAllShapes(Ball *b, const Shape *shapes, int n, flo
         for (int i=0;i<n;++i){
             float dx = seedX - shapes[i].x, dy = seedY - shapes[i].y;
             float d  = sqrtf(dx*dx + dy*dy);
-            float hull = d + ShapeHullRadius(&shapes[i]) + b->r + SPAWN_MARGIN;
+            float hull = d + ShapeCollideRadius(&shapes[i]) + b->r + SPAWN_MARGIN;
             if (hull > maxHull) maxHull = hull;
         }
         float extra  = (float)GetRandomValue(0, 200);
@@ -354,7 +587,85 @@ static void RespawnBallOutsideAllShapes(Ball *b, const Shape *shapes, int n, flo
     for (int i=0;i<n;++i) PushOutsideHull(&shapes[i], b->r, &b->x, &b->y);
 }
 
+// ----- Trapped-ball depenetration -----
+// Signed distance from a point to what the shape collides with, and the
+// outward unit normal.
+static inline float ShapeDistanceNormal(const Shape *sh, float px, float py, float *nx, float *ny){
+    float scale;
+    const TexSdf *sd = ShapeSdf(sh, &scale);
+    if (sd) return ShapeSdfDistance(sh, sd, scale, px, py, nx, ny);
+    float dx = px - sh->x, dy = py - sh->y;
+    if (sh->type != SHAPE_SQUARE){
+        float d = sqrtf(dx*dx + dy*dy);
+        if (d > 1e-6f){ *nx = dx/d; *ny = dy/d; } else { *nx = 1.0f; *ny = 0.0f; }
+        return d - sh->radius;
+    }
+    const float PI_F = 3.14159265358979323846f;
+    float a = sh->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
+    Vector2 pl = InvRotateCS((Vector2){ dx, dy }, c, s);
+    float qx = fabsf(pl.x) - sh->half, qy = fabsf(pl.y) - sh->half, d;
+    Vector2 nl;
+    if (qx > 0.0f || qy > 0.0f){
+        float ox = (qx > 0.0f) ? qx : 0.0f, oy = (qy > 0.0f) ? qy : 0.0f;
+        d  = sqrtf(ox*ox + oy*oy);
+        nl = (Vector2){ copysignf(ox/d, pl.x), copysignf(oy/d, pl.y) };
+    } else if (qx > qy){
+        d = qx; nl = (Vector2){ copysignf(1.0f, pl.x), 0.0f };   // nearest face wins inside
+    } else {
+        d = qy; nl = (Vector2){ 0.0f, copysignf(1.0f, pl.y) };
+    }
+    Vector2 n = RotateCS(nl, c, s);
+    *nx = n.x; *ny = n.y;
+    return d;
+}
+
+// Moves a ball whose centre is inside a shape out along the deepest shape's
+// gradient, O(1) per push instead of a respawn's probe loops. A push can land
+// it in a neighbour or against a wall, so it is repeated up to DEPEN_ITERS
+// times; returns 0 if the ball is still inside and needs the respawn.
+static int DepenetrateBall(Ball *b, const Shape *shapes, int n, float sw, float sh){
+    for (int it=0; it<DEPEN_ITERS; ++it){
+        int best = -1;
+        float d = 0.0f, nx = 0.0f, ny = 0.0f;
+        for (int k=0;k<n;++k){
+            if (!PointInShapeSolid(b->x, b->y, &shapes[k])) continue;
+            float cx, cy, dk = ShapeDistanceNormal(&shapes[k], b->x, b->y, &cx, &cy);
+            if (best < 0 || dk < d){ best = k; d = dk; nx = cx; ny = cy; }
+        }
+        if (best < 0) return 1;
+        float push = ((it == 0) ? b->r - d : -d) + SEP_BIAS;   // after the first push, just clear the centre
+        b->x += nx * push; b->y += ny * push;
+        float vn = b->vx * nx + b->vy * ny;
+        if (vn < 0.0f){ b->vx -= 2.0f * vn * nx; b->vy -= 2.0f * vn * ny; }
+        if (b->x < b->r){ b->x = b->r; b->vx = -b->vx; } else if (b->x > sw - b->r){ b->x = sw - b->r; b->vx = -b->vx; }
+        if (b->y < b->r){ b->y = b->r; b->vy = -b->vy; } else if (b->y > sh - b->r){ b->y = sh - b->r; b->vy = -b->vy; }
+    }
+    return !CenterInsideAnyShape(shapes, n, b->x, b->y);
+}
+
 // ----- Ball vs. shape collision -----
+// Bounce off the shape's surface at the ball. With KINEMATIC_SHAPES the
+// reflection is taken relative to the surface velocity there (translation,
+// spin and pinch), so a moving wall bats the ball ahead of it instead of
+// running it over; a ball already outrunning the surface is left alone.
+static inline void ReflectOffShape(const Shape *sh, float px, float py, float nx, float ny, float *vx, float *vy){
+#if KINEMATIC_SHAPES
+    float ox = px - sh->x, oy = py - sh->y;
+    float sx = sh->vx - sh->w*oy + sh->grow*ox, sy = sh->vy + sh->w*ox + sh->grow*oy;
+    float vn = (*vx - sx)*nx + (*vy - sy)*ny;
+    if (vn >= 0.0f) return;
+    float ux = *vx - 2.0f*vn*nx, uy = *vy - 2.0f*vn*ny;
+    float lim2 = *vx * *vx + *vy * *vy, u2 = ux*ux + uy*uy;
+    if (lim2 < KICK_MAX_SPEED*KICK_MAX_SPEED) lim2 = KICK_MAX_SPEED*KICK_MAX_SPEED;
+    if (u2 > lim2){ float sc = sqrtf(lim2 / u2); ux *= sc; uy *= sc; }
+    *vx = ux; *vy = uy;
+#else
+    (void)sh; (void)px; (void)py;
+    Vector2 vRef = Reflect((Vector2){ *vx, *vy }, (Vector2){ nx, ny });
+    *vx = vRef.x; *vy = vRef.y;
+#endif
+}
+
 static inline void ResolveCircleVsSquare(const Shape *sq, float radius, float *bx, float *by, float *vx, float *vy){
     const float PI_F = 3.14159265358979323846f;
     float a = sq->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
@@ -380,8 +691,7 @@ static inline void ResolveCircleVsSquare(const Shape *sq, float radius, float *b
         Vector2 nW = RotateCS(nL, c, s);
         *bx += nW.x * penetration; *by += nW.y * penetration;
 
-        Vector2 vRef = Reflect((Vector2){ *vx, *vy }, nW);
-        *vx = vRef.x; *vy = vRef.y;
+        ReflectOffShape(sq, *bx, *by, nW.x, nW.y, vx, vy);
 
         *bx += (*vx) * (1.0f/8000.0f);
         *by += (*vy) * (1.0f/8000.0f);
@@ -399,16 +709,90 @@ static inline void ResolveCircleVsCircle(const Shape *sc, float radius, float *b
         float penetration = (rSum - d) + SEP_BIAS; if (penetration < 0.0f) penetration = 0.0f;
         *bx += n.x * penetration; *by += n.y * penetration;
 
-        Vector2 vRef = Reflect((Vector2){ *vx, *vy }, n);
-        *vx = vRef.x; *vy = vRef.y;
+        ReflectOffShape(sc, *bx, *by, n.x, n.y, vx, vy);
 
         *bx += (*vx) * (1.0f/8000.0f);
         *by += (*vy) * (1.0f/8000.0f);
     }
 }
+// The sampled normal wobbles along a silhouette, so only a ball still heading
+// into the surface is reflected; one already leaving just gets pushed out.
+static inline void ResolveCircleVsSdf(const Shape *sh, const TexSdf *sd, float scale, float radius,
+                                      float *bx, float *by, float *vx, float *vy){
+    float nx, ny;
+    float d = ShapeSdfDistance(sh, sd, scale, *bx, *by, &nx, &ny);
+    if (d > radius) return;
+    float penetration = (radius - d) + SEP_BIAS;
+    *bx += nx * penetration; *by += ny * penetration;
+
+    if (KINEMATIC_SHAPES || *vx * nx + *vy * ny < 0.0f) ReflectOffShape(sh, *bx, *by, nx, ny, vx, vy);
+
+    *bx += (*vx) * (1.0f/8000.0f);
+    *by += (*vy) * (1.0f/8000.0f);
+}
 static inline void ResolveCircleVsShape(const Shape *sh, float radius, float *bx, float *by, float *vx, float *vy){
-    if (sh->type==SHAPE_SQUARE) ResolveCircleVsSquare(sh, radius, bx, by, vx, vy);
-    else                        ResolveCircleVsCircle(sh, radius, bx, by, vx, vy);
+    float scale;
+    const TexSdf *sd = ShapeSdf(sh, &scale);
+    if      (sd)                     ResolveCircleVsSdf(sh, sd, scale, radius, bx, by, vx, vy);
+    else if (sh->type==SHAPE_SQUARE) ResolveCircleVsSquare(sh, radius, bx, by, vx, vy);
+    else                             ResolveCircleVsCircle(sh, radius, bx, by, vx, vy);
+}
+
+// ----- Moving shapes -----
+// Input just teleports shapes; this turns the frame's change of pose into
+// the surface motion the resolvers above bounce off.
+static void ShapeSetMotion(Shape *sh, const Shape *prev, float dt){
+    const float PI_F = 3.14159265358979323846f;
+    sh->vx = sh->vy = sh->w = sh->grow = 0.0f;
+    sh->mx = sh->x - prev->x; sh->my = sh->y - prev->y;
+    if (dt <= 0.0f || sh->type != prev->type || sh->texId != prev->texId) return;
+    float size0 = ShapeCollideRadius(prev), size1 = ShapeCollideRadius(sh);
+    sh->vx   = sh->mx / dt; sh->vy = sh->my / dt;
+    sh->w    = (TextureDrawAngle(sh) - TextureDrawAngle(prev)) * (PI_F/180.0f) / dt;
+    sh->grow = (size1 > 0.0f) ? (size1 - size0) / size1 / dt : 0.0f;
+}
+
+// A shape that moved this frame plows through the balls in its path. In the
+// shape's frame the ball travels back along the shape's motion; marching that
+// path by distance finds where the leading face met it. The ball is left
+// there, touching the face at the shape's new pose, and batted ahead; a ball
+// already touching the face is carried along. Returns 1 if it moved the ball.
+static int SweepBallByShape(Ball *b, const Shape *sh){
+    const float mx = sh->mx, my = sh->my, len2 = mx*mx + my*my;
+    if (len2 <= b->r * b->r) return 0;   // can't overrun the centre: the resolver's push is enough
+    // Swept hull: only the leading half of the capsule between the old and
+    // new centres can strike; the trailing side moves away.
+    float wx = b->x - sh->x + mx, wy = b->y - sh->y + my;
+    float u = (wx*mx + wy*my) / len2;
+    if (u <= 0.0f) return 0;
+    u = (u > 1.0f) ? 1.0f : u;
+    float ex = wx - mx*u, ey = wy - my*u, reach = ShapeCollideRadius(sh) + b->r;
+    if (ex*ex + ey*ey > reach*reach) return 0;
+
+    float qx = b->x + mx, qy = b->y + my;   // the ball against the shape's old pose
+    float nx, ny, t = 0.0f, len = sqrtf(len2);
+    float d = ShapeDistanceNormal(sh, qx, qy, &nx, &ny);
+    if (d < 0.0f) return 0;                                               // was inside already: depenetration's job
+    if (d < b->r){
+        // Touching: carried only if the shape moves into it and overran the
+        // centre; a shallower overlap is the resolver's ordinary push.
+        float cx, cy;
+        if (mx*nx + my*ny <= 0.0f || ShapeDistanceNormal(sh, b->x, b->y, &cx, &cy) >= 0.0f) return 0;
+    } else {
+        int hit = 0;
+        for (int it=0; it<PLOW_MARCH_STEPS; ++it){
+            float gap = d - b->r;
+            if (gap < 0.25f && mx*nx + my*ny > 0.0f){ hit = 1; break; }
+            t += ((gap > 0.25f) ? gap : 0.25f) / len;
+            if (t > 1.0f) return 0;
+            d = ShapeDistanceNormal(sh, qx - mx*t, qy - my*t, &nx, &ny);
+        }
+        if (!hit) return 0;
+    }
+    b->x = qx - mx*t + nx*SEP_BIAS;
+    b->y = qy - my*t + ny*SEP_BIAS;
+    ReflectOffShape(sh, b->x, b->y, nx, ny, &b->vx, &b->vy);
+    return 1;
 }
 
 // ----- Web callbacks -----
@@ -472,9 +856,7 @@ static void DrawShapeWithTexture(const Shape *sh){
         if (TextureIndexOk(sh->texId)){
             Texture2D tex = gTextures[sh->texId];
             float sx = (float)tex.width, sy = (float)tex.height;
-            float sCover   = fmaxf(sideNow/sx, sideNow/sy);
-            float sContain = fminf(sideNow/sx, sideNow/sy);
-            float scale = (sh->fit == TEX_FIT_COVER) ? sCover : sContain;
+            float scale = TextureDrawScale(sh, tex);
             Rectangle src  = (Rectangle){0,0,sx,sy};
             Rectangle dest = (Rectangle){sh->x, sh->y, sx*scale, sy*scale};
             Vector2   org  = (Vector2){dest.width*0.5f, dest.height*0.5f};
@@ -487,18 +869,14 @@ static void DrawShapeWithTexture(const Shape *sh){
         DrawCircleLines((int)sh->x, (int)sh->y, (int)ShapeHullRadius(sh), (Color){255,0,0,80});
 #endif
     } else { // circle
-        float d = sh->radius * 2.0f;
         if (TextureIndexOk(sh->texId)){
             Texture2D tex = gTextures[sh->texId];
             float sx = (float)tex.width, sy = (float)tex.height;
-            float sCover   = fmaxf(d/sx, d/sy);
-            float sContain = fminf(d/sx, d/sy);
-            float scale    = (sh->fit == TEX_FIT_COVER) ? sCover : sContain;
+            float scale    = TextureDrawScale(sh, tex);
             Rectangle src  = (Rectangle){ 0, 0, sx, sy };
             Rectangle dest = (Rectangle){ sh->x, sh->y, sx*scale, sy*scale };
             Vector2   org  = (Vector2){ dest.width*0.5f, dest.height*0.5f };
-            float     ang  = ROTATE_TEXTURES ? sh->angle : 0.0f;
-            DrawTexturePro(tex, src, dest, org, ang, sh->tint); // rotate image on circle
+            DrawTexturePro(tex, src, dest, org, TextureDrawAngle(sh), sh->tint); // rotate image on circle
         } else {
             DrawCircleV(V2(sh->x, sh->y), sh->radius, (Color){245,245,245,255});
         }
@@ -617,6 +995,10 @@ int main(void){
         const float dt   = GetFrameTime();
         const int   swWin = GetScreenWidth();
         const int   shWin = GetScreenHeight();
+#if KINEMATIC_SHAPES
+        Shape shapesBefore[NUM_SHAPES];
+        memcpy(shapesBefore, shapes, sizeof(shapes));
+#endif
 
         // ---------- INPUT ----------
         int touchCount = GetTouchPointCount();
@@ -859,8 +1241,14 @@ int main(void){
 #endif
 
         // ---------- Simulation (balls) ----------
+#if KINEMATIC_SHAPES
+        for (int k=0;k<NUM_SHAPES;++k) ShapeSetMotion(&shapes[k], &shapesBefore[k], dt);
+#endif
         for (int i=0;i<NUM_BALLS;++i){
             Ball *b = &balls[i];
+#if KINEMATIC_SHAPES
+            for (int k=0;k<NUM_SHAPES;++k) SweepBallByShape(b, &shapes[k]);
+#endif
 
             float spd = hypotf(b->vx, b->vy);
             int steps = (spd > 0.0f) ? 1 + (int)((spd * dt) / fmaxf(b->r*2.0f, 2.0f)) : 1;
@@ -878,7 +1266,7 @@ int main(void){
 
                 for (int k=0;k<NUM_SHAPES;++k){
                     float dx = b->x - shapes[k].x, dy = b->y - shapes[k].y;
-                    float reach = ShapeHullRadius(&shapes[k]) + b->r;
+                    float reach = ShapeCollideRadius(&shapes[k]) + b->r;
                     if (dx*dx + dy*dy <= reach*reach){
                         ResolveCircleVsShape(&shapes[k], b->r, &b->x, &b->y, &b->vx, &b->vy);
                     }
@@ -887,9 +1275,9 @@ int main(void){
 
             int insideAny = 0;
             for (int k=0;k<NUM_SHAPES && !insideAny;++k){
-                if (PointInShape(b->x, b->y, &shapes[k])) insideAny = 1;
+                if (PointInShapeSolid(b->x, b->y, &shapes[k])) insideAny = 1;
             }
-            if (insideAny){
+            if (insideAny && !(DEPENETRATE && DepenetrateBall(b, shapes, NUM_SHAPES, (float)swWin, (float)shWin))){
                 RespawnBallOutsideAllShapes(b, shapes, NUM_SHAPES, swWin*0.5f, shWin*0.5f);
             } else {
                 b->trappedFrames = 0;
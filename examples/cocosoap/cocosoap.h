@@ -0,0 +1,237 @@
+// cocosoap.h — build toggles, tunables, the config block and the small helpers every file shares
+#ifndef COCOSOAP_H
+#define COCOSOAP_H
+
+#include "raylib.h"
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef PLATFORM_WEB
+    #include <emscripten/emscripten.h>
+    #include <emscripten/html5.h>
+#endif
+
+// ------------ Build-time toggles ------------
+#define DEBUG_DRAW        0
+#define SHAPE_SHAPE_PUSH  1
+#define BALL_BALL_COLLIDE 0   // elastic ball↔ball contacts via spatial hash
+#define SIMD_NARROWPHASE  1   // resolve ball↔shape contacts 4 balls at a time
+#define FIXED_TIMESTEP    1   // sim advances in SIM_HZ steps; balls are drawn interpolated
+#define SWEPT_CCD         1   // contact balls sweep to time of impact instead of substepping
+#define SUBSTEP_BUCKETS   1   // balls sorted into 1/2/4/8-step buckets by speed; each substep (or CCD sweep piece) runs a dense prefix
+#define ROTATE_TEXTURES   1   // twist / right-drag rotates (squares = geom, circles = texture)
+#define SHOW_STATS        0   // top-left overlay with per-phase timings
+#define SIM_BENCH_FRAMES  0   // >0: run this many frames, log avg sim cost, then exit
+#define HIT_BENCH         0   // >0: time this many pointer hit-tests at startup, grid vs. linear
+#define FREE_SPACE_SPAWN  1   // respawn samples a free-cell list instead of rejection loops
+#define BALL_SLEEP        1   // resting balls skip the sim until a moving shape or resize wakes them
+#define TUNNEL_BENCH      0   // thin scattered squares + fast balls; stats log tunnel/trap rates
+#define DETERMINISTIC     0   // seeded RNG, one SIM_HZ step per frame, portable trig, state hash per step
+#define TEXTURE_SDF       1   // textured shapes collide with their image silhouette (SDF baked from alpha)
+#define SDF_BENCH         0   // >0: time this many silhouette distance queries at startup vs. the analytic circle
+#define DEPENETRATE       1   // trapped balls are pushed out along the shape's distance gradient; respawn is the fallback
+#define DRAG_BENCH        0   // >0: sweep shape 0 across the window at this many px/s (pair with SIM_BENCH_FRAMES)
+#define KINEMATIC_SHAPES  1   // dragged/pinched/twisted shapes carry their velocity: moving-wall bounces, swept plowing
+#define COMPACT_BALLS     0   // balls live as 10-byte quantized records; the sim runs them through a float chunk
+#define BALL_SDF_RENDER   1   // balls drawn as instanced quads with a shader-cut circle; sprite atlas / DrawCircleV if the shader or instancing fails
+#define BALL_SPRITE_ATLAS 1   // no shader: balls drawn as tinted quads from a pre-baked circle atlas
+#define RENDER_BENCH      0   // >0: at startup, draw this many frames of 3k/10k/50k balls per ball path, log FPS
+#define TINY_BALL_BATCH   1   // DrawCircleV path: r <= 1.5 balls go out as one pixel-triangle run instead of DrawPixelV each
+#define ADAPTIVE_CIRCLES  1   // untextured circles and DrawCircleV-path balls get segments from their radius, not a fixed 36
+#define TEX_ATLAS         1   // texture bank packed into one texture (plus the shapes' white texel): the shape layer is one batch
+// -------------------------------------------
+
+#if COMPACT_BALLS && (BALL_SLEEP || BALL_BALL_COLLIDE || DETERMINISTIC)
+#error "COMPACT_BALLS sims one chunk at a time: turn off BALL_SLEEP, BALL_BALL_COLLIDE and DETERMINISTIC"
+#endif
+
+#if DETERMINISTIC && defined(__clang__)
+#pragma STDC FP_CONTRACT OFF   // no fused multiply-adds: native and wasm must round alike
+#endif
+
+// ---------------- Tunables -----------------
+#ifndef NUM_BALLS
+#define NUM_BALLS   3000    // startup count; AppSetBallCount changes it at runtime
+#endif
+#ifndef NUM_SHAPES
+#define NUM_SHAPES  10      // startup count; shapes past the preset rows are scattered
+#endif
+#ifndef SIM_HZ
+#define SIM_HZ      120     // fixed sim rate when FIXED_TIMESTEP is on
+#endif
+#ifndef SIM_SEED
+#define SIM_SEED    1       // RNG seed when DETERMINISTIC is on
+#endif
+#ifndef SIM_THREADS
+#if defined(PLATFORM_WEB) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define SIM_THREADS 1       // plain wasm build: no SharedArrayBuffer, no workers
+#else
+#define SIM_THREADS 8       // ball sim worker pool size (calling thread included)
+#endif
+#endif
+
+static const float BALL_RADIUS_MIN = 1.0f;
+static const float BALL_RADIUS_MAX = 20.0f;
+static const float SPEED_MIN       = 0.0f;
+static const float SPEED_MAX       = TUNNEL_BENCH ? 1500.0f : 50.0f;
+
+static const float SQUARE_MIN_SIDE = 1.0f;
+static const float SQUARE_MAX_SIDE = 50.0f;
+
+static const float CIRCLE_R_MIN    = 20.0f;
+static const float CIRCLE_R_MAX    = 300.0f;   // polygons share the circle limits (circumradius)
+
+static const float SPAWN_MARGIN         = 6.0f;
+static const float SPAWN_CELL_PX        = 8.0f;   // free-space map resolution
+static const int   SDF_RES              = 64;     // silhouette SDF cells on the texture's long side
+static const int   SDF_ALPHA_CUT        = 128;    // mean alpha at or above this is solid
+static const int   SDF_MARCH_STEPS      = 24;     // sphere-tracing steps per silhouette sweep
+static const float SLEEP_SPEED          = 0.5f;   // px/s; slower balls are put to sleep
+static const float GRID_CELL_PX         = 64.0f;  // broadphase cell size
+#if DETERMINISTIC
+static const int   HASH_LOG_STEPS       = 120;    // log the state hash this often
+#endif
+static const float HIT_CELL_PX          = 32.0f;  // pointer hit-test grid cell size
+static const float HIT_PAD              = 8.0f;   // slack for shapes moved by input since the last rebuild
+static const int   MAX_SUBSTEPS         = SUBSTEP_BUCKETS ? 8 : 2;   // only fast balls pay for the extra steps
+static const int   CCD_MAX_TOI          = 2;      // impacts resolved per ball per step with SWEPT_CCD
+static const int   DEPEN_ITERS          = 3;      // pushes per trapped ball before it is respawned instead
+static const int   POLY_DEFAULT_SIDES   = 6;      // polygon sides when a ShapeInit gives fewer than 3
+static const float KICK_MAX_SPEED       = TUNNEL_BENCH ? 3000.0f : 100.0f;   // px/s; moving shapes never bat balls faster
+#if FIXED_TIMESTEP && !DETERMINISTIC
+static const int   MAX_CATCHUP_STEPS    = 4;      // sim steps per frame before a hitch's backlog is dropped
+#endif
+static const float SEP_BIAS             = 0.50f;
+static const int   SIM_MIN_SLICE        = 2048;   // fewer balls per worker than this isn't worth a wake-up
+#if COMPACT_BALLS
+static const int   COMPACT_CHUNK        = 65536;  // balls unpacked to floats per sim pass
+#endif
+static const float BALL_ATLAS_STEP      = 1.25f;  // radius ratio between sprite atlas buckets
+static const int   TEX_ATLAS_CELL       = 1024;   // TEX_ATLAS: bank images scaled to this long side, px (shrunk further to fit)
+static const int   TEX_ATLAS_MAX        = 4096;   // TEX_ATLAS: atlas side limit; WebGL guarantees less, but every target we run has it
+static const int   TEX_ATLAS_PAD        = 2;      // TEX_ATLAS: edge pixels repeated this far around each image
+static const float CIRCLE_CHORD_ERR     = 0.25f;  // ADAPTIVE_CIRCLES: max gap between a segment and the true rim, px
+static const float TOUCH_DELTA_DEADZONE = 0.5f;
+// -------------------------------------------
+
+// Gradient stops for ball colors
+static const Color GRADIENT_STOPS[] = {
+    (Color){255,255,255,255},
+    (Color){255,141,161,255}
+};
+static const int GRADIENT_COUNT = (int)(sizeof(GRADIENT_STOPS)/sizeof(GRADIENT_STOPS[0]));
+
+// ================== CONFIG BLOCK (EDIT HERE) ==================
+typedef enum { SHAPE_SQUARE = 0, SHAPE_CIRCLE = 1, SHAPE_POLYGON = 2 } ShapeType;
+#define POLY_MAX_VERTS 16   // vertex cap for SHAPE_POLYGON
+typedef enum { TEX_FIT_COVER=0, TEX_FIT_CONTAIN=1 } TexFit;
+
+#define TEX_COUNT 5
+typedef struct {
+    ShapeType type;
+    float     x, y;
+    float     size;       // squares = side px, circles/polygons = diameter px
+    float     angle;      // squares/polygons: geometry rotation; circles: texture rotation
+    int       texId;      // -1 = no texture, else index into TEX_PATHS
+    TexFit    fit;        // TEX_FIT_COVER | TEX_FIT_CONTAIN
+    Color     tint;       // WHITE = no tint
+    int       nVerts;     // polygons: vertex count (3..POLY_MAX_VERTS)
+    const Vector2 *verts; // polygons: convex outline around (0,0), any scale/winding; NULL = regular nVerts-gon
+} ShapeInit;
+
+static const ShapeInit SHAPES_PRESET[] = {
+    { SHAPE_CIRCLE,  640, 620, 200,  0, 0, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 240, 820, 200,  0, 1, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 940, 920, 200,  0, 2, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 240, 920, 200,  0, 3, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 540, 920, 200,  0, 4, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE,  920, 320, 200,  0, 0, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 280, 420, 200,  0, 1, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 640, 320, 200,  0, 2, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 840, 320, 200,  0, 3, TEX_FIT_COVER,   WHITE, 0, NULL },
+    { SHAPE_CIRCLE, 640, 920, 200,  0, 4, TEX_FIT_COVER,   WHITE, 0, NULL },
+};
+static const int PRESET_COUNT = (int)(sizeof(SHAPES_PRESET)/sizeof(SHAPES_PRESET[0]));
+// ================= END CONFIG BLOCK =================
+
+// --------- Helpers ---------
+static inline Vector2 V2(float x, float y){ Vector2 v=(Vector2){x,y}; return v; }
+static inline Vector2 RotateCS(Vector2 v, float c, float s){ return (Vector2){ c*v.x - s*v.y, s*v.x + c*v.y }; }
+static inline Vector2 InvRotateCS(Vector2 v, float c, float s){ return (Vector2){ c*v.x + s*v.y, -s*v.x + c*v.y }; }
+static inline Vector2 Reflect(Vector2 v, Vector2 n){ float d=v.x*n.x + v.y*n.y; return (Vector2){ v.x-2.0f*d*n.x, v.y-2.0f*d*n.y }; }
+
+// ----- Sim RNG + portable trig -----
+// Everything the sim draws comes from one counter-based stream (SplitMix64 of
+// seed + counter), so a seed replays the same spawns on any target. Outside
+// DETERMINISTIC the seed is taken from raylib's time-seeded RNG.
+typedef struct { uint64_t seed, counter; } SimRng;
+extern SimRng gSimRng;   // defined in sim.c
+
+static inline void SimRngSeed(uint64_t seed){ gSimRng.seed = seed; gSimRng.counter = 0; }
+static inline uint64_t SimRngNext(void){
+    uint64_t z = gSimRng.seed + (++gSimRng.counter) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+// Uniform int in [min, max], like GetRandomValue (multiply-shift, no modulo).
+static inline int SimRandInt(int min, int max){
+    if (max <= min) return min;
+    uint64_t range = (uint64_t)((int64_t)max - (int64_t)min + 1);
+    return min + (int)(((SimRngNext() >> 32) * range) >> 32);
+}
+
+// libm sinf/cosf differ between glibc and the wasm libc, so the deterministic
+// build uses this: range-reduce to [-45, 45] degrees, then minimax
+// polynomials. Only +, * and floorf, so any IEEE target rounds the same.
+static inline void DetSinCosDeg(float deg, float *s, float *c){
+    float turns = deg * (1.0f/360.0f);
+    turns -= floorf(turns + 0.5f);
+    float q  = floorf(turns * 4.0f + 0.5f);
+    float x  = (turns - q * 0.25f) * 6.28318530718f;
+    float x2 = x*x;
+    float sn = x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333310e-3f + x2 * -1.9840874e-4f)));
+    float cs = 1.0f + x2 * (-0.5f + x2 * (4.1666638e-2f + x2 * (-1.3888378e-3f + x2 * 2.4760495e-5f)));
+    switch (((int)q) & 3){
+        case 0:  *s =  sn; *c =  cs; break;
+        case 1:  *s =  cs; *c = -sn; break;
+        case 2:  *s = -sn; *c = -cs; break;
+        default: *s = -cs; *c =  sn; break;
+    }
+}
+static inline void SimSinCosDeg(float deg, float *s, float *c){
+#if DETERMINISTIC
+    DetSinCosDeg(deg, s, c);
+#else
+    const float a = deg * (3.14159265358979323846f/180.0f);
+    *s = sinf(a); *c = cosf(a);
+#endif
+}
+
+static inline Color LerpColor(Color a, Color b, float t){
+    if (t < 0.0f) t = 0.0f; if (t > 1.0f) t = 1.0f;
+    Color c;
+    c.r = (unsigned char)(a.r + (b.r - a.r) * t);
+    c.g = (unsigned char)(a.g + (b.g - a.g) * t);
+    c.b = (unsigned char)(a.b + (b.b - a.b) * t);
+    c.a = (unsigned char)(a.a + (b.a - a.a) * t);
+    return c;
+}
+static inline Color GradientSample(const Color *stops, int count, float t){
+    if (count <= 0) return WHITE;
+    if (count == 1) return stops[0];
+    if (t <= 0.0f) return stops[0];
+    if (t >= 1.0f) return stops[count-1];
+    float seg = t * (float)(count - 1);
+    int   i   = (int)seg;
+    float ft  = seg - (float)i;
+    if (i >= count - 1) { i = count - 2; ft = 1.0f; }
+    return LerpColor(stops[i], stops[i+1], ft);
+}
+
+#endif
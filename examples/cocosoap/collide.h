@@ -0,0 +1,231 @@
+// collide.h — scalar ball vs. shape kernels: discrete resolvers and swept time-of-impact tests
+#ifndef COLLIDE_H
+#define COLLIDE_H
+#include "shapes.h"
+
+// ----- Ball vs. shape collision -----
+// Bounce off the shape's surface at the ball. With KINEMATIC_SHAPES the
+// reflection is taken relative to the surface velocity there (translation,
+// spin and pinch), so a moving wall bats the ball ahead of it instead of
+// running it over; a ball already outrunning the surface is left alone.
+static inline void ReflectOffShape(const ShapeCompiled *k, float px, float py, float nx, float ny, float *vx, float *vy){
+#if KINEMATIC_SHAPES
+    float ox = px - k->x, oy = py - k->y;
+    float sx = k->vx - k->w*oy + k->grow*ox, sy = k->vy + k->w*ox + k->grow*oy;
+    float vn = (*vx - sx)*nx + (*vy - sy)*ny;
+    if (vn >= 0.0f) return;
+    float ux = *vx - 2.0f*vn*nx, uy = *vy - 2.0f*vn*ny;
+    float lim2 = *vx * *vx + *vy * *vy, u2 = ux*ux + uy*uy;
+    if (lim2 < KICK_MAX_SPEED*KICK_MAX_SPEED) lim2 = KICK_MAX_SPEED*KICK_MAX_SPEED;
+    if (u2 > lim2){ float sc = sqrtf(lim2 / u2); ux *= sc; uy *= sc; }
+    *vx = ux; *vy = uy;
+#else
+    (void)k; (void)px; (void)py;
+    Vector2 vRef = Reflect((Vector2){ *vx, *vy }, (Vector2){ nx, ny });
+    *vx = vRef.x; *vy = vRef.y;
+#endif
+}
+
+static inline void ResolveCircleVsSquare(const ShapeCompiled *sq, float radius, float *bx, float *by, float *vx, float *vy){
+    const float c = sq->c, s = sq->s;
+
+    Vector2 pW = (Vector2){ *bx - sq->x, *by - sq->y };
+    Vector2 vW = (Vector2){ *vx, *vy };
+    Vector2 pL = InvRotateCS(pW, c, s);
+    Vector2 vL = InvRotateCS(vW, c, s);
+
+    float h = sq->half;
+    float cx = (pL.x < -h) ? -h : (pL.x >  h) ?  h : pL.x;
+    float cy = (pL.y < -h) ? -h : (pL.y >  h) ?  h : pL.y;
+
+    float dx = pL.x - cx, dy = pL.y - cy;
+    float dist2 = dx*dx + dy*dy;
+
+    if (dist2 <= radius*radius){
+        float dist = (dist2 > 0.0f) ? sqrtf(dist2) : 0.0f;
+        Vector2 nL = (dist > 1.0f)? (Vector2){ dx/dist, dy/dist }
+                                  : (fabsf(vL.x) > fabsf(vL.y)) ? (Vector2){ (vL.x>0.0f)?1.0f:-1.0f, 0.0f }
+                                                                 : (Vector2){ 0.0f, (vL.y>0.0f)?1.0f:-1.0f };
+        float penetration = (radius - dist) + SEP_BIAS; if (penetration < 0.0f) penetration = 0.0f;
+        Vector2 nW = RotateCS(nL, c, s);
+        *bx += nW.x * penetration; *by += nW.y * penetration;
+
+        ReflectOffShape(sq, *bx, *by, nW.x, nW.y, vx, vy);
+
+        *bx += (*vx) * (1.0f/8000.0f);
+        *by += (*vy) * (1.0f/8000.0f);
+    }
+}
+static inline void ResolveCircleVsCircle(const ShapeCompiled *sc, float radius, float *bx, float *by, float *vx, float *vy){
+    float dx = *bx - sc->x, dy = *by - sc->y;
+    float rSum = radius + sc->radius;
+    float d2   = dx*dx + dy*dy;
+    if (d2 <= rSum*rSum){
+        float d = (d2>0.0f)? sqrtf(d2) : 0.0f;
+        Vector2 n = (d>1.0e-6f)? (Vector2){ dx/d, dy/d }
+                               : (fabsf(*vx) > fabsf(*vy)) ? (Vector2){ (*vx>0.0f)?1.0f:-1.0f, 0.0f }
+                                                           : (Vector2){ 0.0f, (*vy>0.0f)?1.0f:-1.0f };
+        float penetration = (rSum - d) + SEP_BIAS; if (penetration < 0.0f) penetration = 0.0f;
+        *bx += n.x * penetration; *by += n.y * penetration;
+
+        ReflectOffShape(sc, *bx, *by, n.x, n.y, vx, vy);
+
+        *bx += (*vx) * (1.0f/8000.0f);
+        *by += (*vy) * (1.0f/8000.0f);
+    }
+}
+// The sampled normal wobbles along a silhouette, so only a ball still heading
+// into the surface is reflected; one already leaving just gets pushed out.
+static inline void ResolveCircleVsSdf(const ShapeCompiled *sk, float radius, float *bx, float *by, float *vx, float *vy){
+    float nx, ny;
+    float d = CompiledSdf(sk, *bx, *by, &nx, &ny);
+    if (d > radius) return;
+    float penetration = (radius - d) + SEP_BIAS;
+    *bx += nx * penetration; *by += ny * penetration;
+
+    if (KINEMATIC_SHAPES || *vx * nx + *vy * ny < 0.0f) ReflectOffShape(sk, *bx, *by, nx, ny, vx, vy);
+
+    *bx += (*vx) * (1.0f/8000.0f);
+    *by += (*vy) * (1.0f/8000.0f);
+}
+static inline void ResolveCircleVsPoly(const ShapeCompiled *sp, float radius, float *bx, float *by, float *vx, float *vy){
+    float nx, ny;
+    float d = PolyDistanceNormal(sp->poly, *bx - sp->x, *by - sp->y, &nx, &ny);
+    if (d > radius) return;
+    float penetration = (radius - d) + SEP_BIAS;
+    *bx += nx * penetration; *by += ny * penetration;
+
+    ReflectOffShape(sp, *bx, *by, nx, ny, vx, vy);
+
+    *bx += (*vx) * (1.0f/8000.0f);
+    *by += (*vy) * (1.0f/8000.0f);
+}
+static inline void ResolveCircleVsShape(const ShapeCompiled *sh, float radius, float *bx, float *by, float *vx, float *vy){
+    if      (sh->sdf)               ResolveCircleVsSdf(sh, radius, bx, by, vx, vy);
+    else if (sh->poly)              ResolveCircleVsPoly(sh, radius, bx, by, vx, vy);
+    else if (sh->type==SHAPE_SQUARE) ResolveCircleVsSquare(sh, radius, bx, by, vx, vy);
+    else                             ResolveCircleVsCircle(sh, radius, bx, by, vx, vy);
+}
+
+// ----- Swept ball vs. shape (time of impact) -----
+// Earliest t in [0,1] at which a circle of radius r moving from p to p+d touches
+// the shape, plus the world contact normal. Starting overlaps report no hit;
+// they are left to the discrete resolvers.
+static inline int SweepCircleVsSquare(const ShapeCompiled *sq, float r, float px, float py, float dx, float dy,
+                                      float *toi, float *nx, float *ny){
+    const float c = sq->c, s = sq->s;
+    Vector2 o = InvRotateCS((Vector2){ px - sq->x, py - sq->y }, c, s);
+    Vector2 v = InvRotateCS((Vector2){ dx, dy }, c, s);
+    const float h = sq->half, e = h + r;
+
+    // Slabs of the box grown by r
+    float ov[2] = { o.x, o.y }, vv[2] = { v.x, v.y };
+    float tmin = 0.0f, tmax = 1.0f, sign = 0.0f;
+    int axis = -1;
+    for (int k=0;k<2;++k){
+        if (fabsf(vv[k]) < 1e-12f){ if (ov[k] < -e || ov[k] > e) return 0; continue; }
+        float inv = 1.0f / vv[k];
+        float t0 = (-e - ov[k]) * inv, t1 = (e - ov[k]) * inv, sg = -1.0f;
+        if (t0 > t1){ float t = t0; t0 = t1; t1 = t; sg = 1.0f; }
+        if (t0 > tmin){ tmin = t0; axis = k; sign = sg; }
+        if (t1 < tmax) tmax = t1;
+        if (tmin > tmax) return 0;
+    }
+    if (axis < 0) return 0;
+
+    // The grown box has rounded corners: re-test against the corner circle
+    Vector2 nL = { (axis == 0) ? sign : 0.0f, (axis == 1) ? sign : 0.0f };
+    float hx = o.x + v.x*tmin, hy = o.y + v.y*tmin;
+    if (r > 0.0f && fabsf(hx) > h && fabsf(hy) > h){
+        float mx = o.x - copysignf(h, hx), my = o.y - copysignf(h, hy);
+        float qa = v.x*v.x + v.y*v.y, qb = mx*v.x + my*v.y, qc = mx*mx + my*my - r*r;
+        float disc = qb*qb - qa*qc;
+        if (qc < 0.0f || qb >= 0.0f || disc < 0.0f) return 0;
+        tmin = (-qb - sqrtf(disc)) / qa;
+        if (tmin > 1.0f) return 0;
+        nL = (Vector2){ (mx + v.x*tmin) / r, (my + v.y*tmin) / r };
+    }
+    Vector2 nW = RotateCS(nL, c, s);
+    *toi = tmin; *nx = nW.x; *ny = nW.y;
+    return 1;
+}
+
+static inline int SweepCircleVsCircle(const ShapeCompiled *sc, float r, float px, float py, float dx, float dy,
+                                      float *toi, float *nx, float *ny){
+    float rs = sc->radius + r;
+    float mx = px - sc->x, my = py - sc->y;
+    float qa = dx*dx + dy*dy, qb = mx*dx + my*dy, qc = mx*mx + my*my - rs*rs;
+    float disc = qb*qb - qa*qc;
+    if (qc < 0.0f || qb >= 0.0f || disc < 0.0f) return 0;
+    float t = (-qb - sqrtf(disc)) / qa;
+    if (t > 1.0f) return 0;
+    *toi = t; *nx = (mx + dx*t) / rs; *ny = (my + dy*t) / rs;
+    return 1;
+}
+
+// Sphere tracing: advance by the current clearance until the ball touches the
+// silhouette while still moving into it. Grazing paths that run out of steps
+// report no hit and are left to the discrete pass.
+static inline int SweepCircleVsSdf(const ShapeCompiled *sk, float r, float px, float py, float dx, float dy,
+                                   float *toi, float *nx, float *ny){
+    float len = sqrtf(dx*dx + dy*dy);
+    if (len < 1e-6f) return 0;
+    float gx, gy, t = 0.0f;
+    float d = CompiledSdf(sk, px, py, &gx, &gy) - r;
+    if (d <= 0.0f) return 0;
+    for (int it=0; it<SDF_MARCH_STEPS; ++it){
+        if (d < 0.25f && gx*dx + gy*dy < 0.0f){ *toi = t; *nx = gx; *ny = gy; return 1; }
+        t += ((d > 0.25f) ? d : 0.25f) / len;
+        if (t > 1.0f) return 0;
+        d = CompiledSdf(sk, px + dx*t, py + dy*t, &gx, &gy) - r;
+    }
+    return 0;
+}
+
+// Clips the path against every edge pushed out by r (Cyrus-Beck), then, as
+// for squares, re-tests a hit past the end of its edge against the corner's
+// circle.
+static inline int SweepCircleVsPoly(const ShapeCompiled *sp, float r, float px, float py, float dx, float dy,
+                                    float *toi, float *nx, float *ny){
+    const PolyCompiled *p = sp->poly;
+    const float ox = px - sp->x, oy = py - sp->y;
+    float tmin = 0.0f, tmax = 1.0f;
+    int edge = -1;
+    for (int i=0;i<p->n;++i){
+        float s0 = p->nx[i]*(ox - p->vx[i]) + p->ny[i]*(oy - p->vy[i]) - r;
+        float rate = p->nx[i]*dx + p->ny[i]*dy;
+        if (fabsf(rate) < 1e-12f){ if (s0 > 0.0f) return 0; continue; }
+        float t = -s0 / rate;
+        if (rate < 0.0f){ if (t > tmin){ tmin = t; edge = i; } }
+        else if (t < tmax) tmax = t;
+        if (tmin > tmax) return 0;
+    }
+    if (edge < 0) return 0;
+
+    Vector2 n = { p->nx[edge], p->ny[edge] };
+    int f = (edge+1 == p->n) ? 0 : edge+1;
+    float ex = p->vx[f] - p->vx[edge], ey = p->vy[f] - p->vy[edge];
+    float u = (ox + dx*tmin - p->vx[edge])*ex + (oy + dy*tmin - p->vy[edge])*ey;
+    if (r > 0.0f && (u < 0.0f || u > ex*ex + ey*ey)){
+        int c = (u < 0.0f) ? edge : f;
+        float mx = ox - p->vx[c], my = oy - p->vy[c];
+        float qa = dx*dx + dy*dy, qb = mx*dx + my*dy, qc = mx*mx + my*my - r*r;
+        float disc = qb*qb - qa*qc;
+        if (qc < 0.0f || qb >= 0.0f || disc < 0.0f) return 0;
+        tmin = (-qb - sqrtf(disc)) / qa;
+        if (tmin > 1.0f) return 0;
+        n = (Vector2){ (mx + dx*tmin) / r, (my + dy*tmin) / r };
+    }
+    *toi = tmin; *nx = n.x; *ny = n.y;
+    return 1;
+}
+
+static inline int SweepCircleVsShape(const ShapeCompiled *sh, float r, float px, float py, float dx, float dy,
+                                     float *toi, float *nx, float *ny){
+    if (sh->sdf)  return SweepCircleVsSdf(sh, r, px, py, dx, dy, toi, nx, ny);
+    if (sh->poly) return SweepCircleVsPoly(sh, r, px, py, dx, dy, toi, nx, ny);
+    return (sh->type==SHAPE_SQUARE) ? SweepCircleVsSquare(sh, r, px, py, dx, dy, toi, nx, ny)
+                                    : SweepCircleVsCircle(sh, r, px, py, dx, dy, toi, nx, ny);
+}
+
+#endif
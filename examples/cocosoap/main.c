@@ -1,9 +1,9 @@
 // main.c — Squares + Circles + per-shape textures + twist-to-rotate + music loop + bottom-right audio UI
-#include "raylib.h"
-#include <math.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdbool.h>
+#include "cocosoap.h"
+#include "shapes.h"
+#include "sim.h"
+#include "pool.h"
+#include "render.h"
 
 // ---- Optional raygui integration -------------------------------------------
 // Compile with -DUSE_RAYGUI and have raygui.h available to use the raygui panel.
@@ -14,40 +14,9 @@
 #endif
 // ----------------------------------------------------------------------------
 
-#ifdef PLATFORM_WEB
-    #include <emscripten/emscripten.h>
-    #include <emscripten/html5.h>
-#endif
-
-// ------------ Build-time toggles ------------
-#define DEBUG_DRAW        0
-#define SHAPE_SHAPE_PUSH  1
-#define ROTATE_TEXTURES   1   // twist / right-drag rotates (squares = geom, circles = texture)
-// -------------------------------------------
-
-// ---------------- Tunables -----------------
-#define NUM_BALLS   3000
-#define NUM_SHAPES  10
-
 // --- GUI + music state ---
 static float gMusicVol    = 0.35f;  // 0..1
 static int   gMusicPaused = 1;      // start paused
-static const float BALL_RADIUS_MIN = 1.0f;
-static const float BALL_RADIUS_MAX = 20.0f;
-static const float SPEED_MIN       = 0.0f;
-static const float SPEED_MAX       = 50.0f;
-
-static const float SQUARE_MIN_SIDE = 1.0f;
-static const float SQUARE_MAX_SIDE = 50.0f;
-
-static const float CIRCLE_R_MIN    = 20.0f;
-static const float CIRCLE_R_MAX    = 300.0f;
-
-static const float SPAWN_MARGIN         = 6.0f;
-static const int   MAX_SUBSTEPS         = 2;
-static const float SEP_BIAS             = 0.50f;
-static const float TOUCH_DELTA_DEADZONE = 0.5f;
-// -------------------------------------------
 
 // ---------- Tap sound config ----------
 static const int   TAP_SR        = 48000;
@@ -60,98 +29,22 @@ static const float FREQ_MIN      = 320.0f;
 static const float FREQ_MAX      = 1600.0f;
 // -------------------------------------
 
-// Gradient stops for ball colors
-static const Color GRADIENT_STOPS[] = {
-    (Color){255,255,255,255},
-    (Color){255,141,161,255}
-};
-static const int GRADIENT_COUNT = (int)(sizeof(GRADIENT_STOPS)/sizeof(GRADIENT_STOPS[0]));
-
-// ================== CONFIG BLOCK (EDIT HERE) ==================
-typedef enum { SHAPE_SQUARE = 0, SHAPE_CIRCLE = 1 } ShapeType;
-typedef enum { TEX_FIT_COVER=0, TEX_FIT_CONTAIN=1 } TexFit;
-
-#define TEX_COUNT 5
-static const char* TEX_PATHS[TEX_COUNT] = {
-    "assets/characters/comp/1.png",
-    "assets/characters/comp/2.png",
-    "assets/characters/comp/3.png",
-    "assets/characters/comp/4.png",
-    "assets/characters/comp/5.png",
-};
-
-typedef struct {
-    ShapeType type;
-    float     x, y;
-    float     size;       // squares = side px, circles = diameter px
-    float     angle;      // squares: geometry rotation; circles: texture rotation
-    int       texId;      // -1 = no texture, else index into TEX_PATHS
-    TexFit    fit;        // TEX_FIT_COVER | TEX_FIT_CONTAIN
-    Color     tint;       // WHITE = no tint
-} ShapeInit;
-
-static const ShapeInit SHAPES_PRESET[NUM_SHAPES] = {
-    { SHAPE_CIRCLE,  640, 620, 200,  0, 0, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 240, 820, 200,  0, 1, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 940, 920, 200,  0, 2, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 240, 920, 200,  0, 3, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 540, 920, 200,  0, 4, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE,  920, 320, 200,  0, 0, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 280, 420, 200,  0, 1, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 640, 320, 200,  0, 2, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 840, 320, 200,  0, 3, TEX_FIT_COVER,   WHITE },
-    { SHAPE_CIRCLE, 640, 920, 200,  0, 4, TEX_FIT_COVER,   WHITE },
-};
-// ================= END CONFIG BLOCK =================
-
-// ----- Texture bank -----
-static Texture2D gTextures[TEX_COUNT] = {0};
-static int gTexLoaded = 0;
-
-static inline int TextureOk(Texture2D t){ return (t.id != 0) && (t.width > 0) && (t.height > 0); }
-static inline int TextureIndexOk(int idx){ return (idx >= 0 && idx < TEX_COUNT && TextureOk(gTextures[idx])); }
-
-static void LoadTextureBank(void){
-    if (gTexLoaded) return;
-    for (int i=0;i<TEX_COUNT;++i){
-        if (FileExists(TEX_PATHS[i])){
-            gTextures[i] = LoadTexture(TEX_PATHS[i]);
-            if (TextureOk(gTextures[i])) SetTextureFilter(gTextures[i], TEXTURE_FILTER_BILINEAR);
-        }
-    }
-    gTexLoaded = 1;
-}
-static void UnloadTextureBank(void){
-    if (!gTexLoaded) return;
-    for (int i=0;i<TEX_COUNT;++i){
-        if (TextureOk(gTextures[i])) UnloadTexture(gTextures[i]);
-        gTextures[i] = (Texture2D){0};
-    }
-    gTexLoaded = 0;
-}
-
 // ----- Types -----
-typedef struct { float x, y, vx, vy, r; int trappedFrames; Color col; } Ball;
-
-typedef struct {
-    ShapeType type;
-    float x, y;     // center
-    float half;     // for squares (half side)
-    float radius;   // for circles
-    float angle;    // squares: geometry; circles: texture
-    int   texId;    // -1 = no texture; else index into gTextures[]
-    TexFit fit;     // scaling mode
-    Color tint;     // tint for texture
-} Shape;
-
 typedef struct { int id; Vector2 pos; } TrackedTouch;
 
 typedef struct {
-    float *dummy;
-    Ball  *balls;
-    int    ballCount;
+    float     *dummy;
+    BallStore *balls;
 } AppState;
 
+#if HIT_BENCH
+// Linear reference for ShapeGridTopAt
+static int TopShapeAt(float px, float py, const Shape *shapes, int count){
+    for (int i=count-1;i>=0;--i) if (PointInShape(px, py, &shapes[i])) return i;
+    return -1;
+}
+#endif
+
 // ---------- Gesture-safe audio + size→pitch ----------
 static int   gAudioReady = 0;
 static Sound gTapIn = (Sound){0}, gTapOut = (Sound){0};
@@ -258,179 +151,70 @@ static void MusicPause(void){
     }
 }
 
-// --------- Helpers ---------
-static inline Vector2 V2(float x, float y){ Vector2 v=(Vector2){x,y}; return v; }
-static inline Vector2 RotateCS(Vector2 v, float c, float s){ return (Vector2){ c*v.x - s*v.y, s*v.x + c*v.y }; }
-static inline Vector2 InvRotateCS(Vector2 v, float c, float s){ return (Vector2){ c*v.x + s*v.y, -s*v.x + c*v.y }; }
-static inline Vector2 Reflect(Vector2 v, Vector2 n){ float d=v.x*n.x + v.y*n.y; return (Vector2){ v.x-2.0f*d*n.x, v.y-2.0f*d*n.y }; }
-
-static inline Color LerpColor(Color a, Color b, float t){
-    if (t < 0.0f) t = 0.0f; if (t > 1.0f) t = 1.0f;
-    Color c;
-    c.r = (unsigned char)(a.r + (b.r - a.r) * t);
-    c.g = (unsigned char)(a.g + (b.g - a.g) * t);
-    c.b = (unsigned char)(a.b + (b.b - a.b) * t);
-    c.a = (unsigned char)(a.a + (b.a - a.a) * t);
-    return c;
-}
-static inline Color GradientSample(const Color *stops, int count, float t){
-    if (count <= 0) return WHITE;
-    if (count == 1) return stops[0];
-    if (t <= 0.0f) return stops[0];
-    if (t >= 1.0f) return stops[count-1];
-    float seg = t * (float)(count - 1);
-    int   i   = (int)seg;
-    float ft  = seg - (float)i;
-    if (i >= count - 1) { i = count - 2; ft = 1.0f; }
-    return LerpColor(stops[i], stops[i+1], ft);
-}
-
-// ----- Shape queries -----
-static inline int PointInSquare(float px, float py, const Shape *sq){
-    const float PI_F = 3.14159265358979323846f;
-    float a = sq->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
-    Vector2 pl = InvRotateCS((Vector2){ px - sq->x, py - sq->y }, c, s);
-    return (fabsf(pl.x) <= sq->half && fabsf(pl.y) <= sq->half);
-}
-static inline int PointInCircle(float px, float py, const Shape *sc){
-    float dx = px - sc->x, dy = py - sc->y;
-    return (dx*dx + dy*dy) <= (sc->radius*sc->radius);
-}
-static inline int PointInShape(float px, float py, const Shape *sh){
-    return (sh->type==SHAPE_SQUARE) ? PointInSquare(px,py,sh) : PointInCircle(px,py,sh);
-}
-static int TopShapeAt(float px, float py, const Shape *shapes, int count){
-    for (int i=count-1;i>=0;--i) if (PointInShape(px, py, &shapes[i])) return i;
-    return -1;
-}
-static inline float ShapeHullRadius(const Shape *sh){
-    return (sh->type==SHAPE_SQUARE)? (sh->half*1.41421356237f) : sh->radius;
-}
-static inline void PushOutsideHull(const Shape *sh, float r, float *bx, float *by){
-    float dx = *bx - sh->x, dy = *by - sh->y;
-    float len2 = dx*dx + dy*dy;
-    float minD = ShapeHullRadius(sh) + r + SPAWN_MARGIN;
-    float minD2 = minD*minD;
-    if (len2 < 1e-8f){ dx=1.0f; dy=0.0f; len2=1.0f; }
-    if (len2 < minD2){
-        float s = minD / sqrtf(len2);
-        *bx = sh->x + dx*s; *by = sh->y + dy*s;
-    }
-}
+// ----- Operator API -----
+// For scaling a running installation (from JS on the web build). Calls only
+// queue requests; main applies them at the top of the next frame, before
+// input, so nothing resizes while the sim or the draw is walking the pools.
+#ifdef PLATFORM_WEB
+    #define APP_API EMSCRIPTEN_KEEPALIVE
+#else
+    #define APP_API
+#endif
 
-// ----- Ball helpers -----
-static inline void AssignBallKinematicsAndColor(Ball *b){
-    const float PI_F = 3.14159265358979323846f;
-    float angle = (float)GetRandomValue(0, 359) * (PI_F/180.0f);
-    float speed = (float)GetRandomValue((int)SPEED_MIN, (int)SPEED_MAX);
-    float t01   = (float)GetRandomValue(0,1000)/1000.0f;
-    b->r   = BALL_RADIUS_MIN + t01 * (BALL_RADIUS_MAX - BALL_RADIUS_MIN);
-    b->col = GradientSample(GRADIENT_STOPS, GRADIENT_COUNT, t01);
-    b->vx  = cosf(angle) * speed;
-    b->vy  = sinf(angle) * speed;
-    if (fabsf(b->vx) < 1e-3f && fabsf(b->vy) < 1e-3f){ b->vx = speed; b->vy = 0.0f; }
-    b->trappedFrames = 0;
-}
+typedef struct { int handle; ShapeInit init; } PendingShape;
 
-static int CenterInsideAnyShape(const Shape *shapes, int n, float px, float py){
-    for (int i=0;i<n;++i) if (PointInShape(px, py, &shapes[i])) return 1;
-    return 0;
+typedef struct {
+    ShapePool       *shapes;
+    const int    *ballTotal;                    // live ball count, in whichever store holds the balls
+    int           ballCount;                    // -1 = unchanged
+    int           reserveBalls, reserveShapes;
+    PendingShape *add;   int nAdd, addCap;
+    int          *remove; int nRemove, removeCap;
+    int           removeTop;                    // topmost shapes to drop
+} AppOps;
+static AppOps gOps = { .ballCount = -1 };
+
+APP_API void AppSetBallCount(int n){ gOps.ballCount = (n < 0) ? 0 : n; }
+APP_API void AppReserve(int balls, int shapes){
+    if (balls  > gOps.reserveBalls)  gOps.reserveBalls  = balls;
+    if (shapes > gOps.reserveShapes) gOps.reserveShapes = shapes;
 }
-
-static void RespawnBallOutsideAllShapes(Ball *b, const Shape *shapes, int n, float seedX, float seedY){
-    AssignBallKinematicsAndColor(b);
-    const int sw = GetScreenWidth();
-    const int sh = GetScreenHeight();
-    const float PI_F = 3.14159265358979323846f;
-
-    for (int tries=0; tries<256; ++tries){
-        float ang = (float)GetRandomValue(0, 359) * (PI_F/180.0f);
-        float maxHull = 0.0f;
-        for (int i=0;i<n;++i){
-            float dx = seedX - shapes[i].x, dy = seedY - shapes[i].y;
-            float d  = sqrtf(dx*dx + dy*dy);
-            float hull = d + ShapeHullRadius(&shapes[i]) + b->r + SPAWN_MARGIN;
-            if (hull > maxHull) maxHull = hull;
-        }
-        float extra  = (float)GetRandomValue(0, 200);
-        float radial = (maxHull > 0.0f ? maxHull : 200.0f) + extra;
-
-        float x = seedX + cosf(ang) * radial;
-        float y = seedY + sinf(ang) * radial;
-
-        if (x < b->r) x = b->r; if (x > sw - b->r) x = sw - b->r;
-        if (y < b->r) y = b->r; if (y > sh - b->r) y = sh - b->r;
-
-        for (int i=0;i<n;++i) PushOutsideHull(&shapes[i], b->r, &x, &y);
-
-        if (!CenterInsideAnyShape(shapes, n, x, y)){ b->x = x; b->y = y; return; }
+APP_API int AppBallCount(void){ return gOps.ballTotal ? *gOps.ballTotal : 0; }
+APP_API int AppShapeCount(void){ return gOps.shapes ? gOps.shapes->count : 0; }
+
+// Returns the new shape's handle right away; the shape appears next frame.
+APP_API int AppAddShape(int type, float x, float y, float size, float angleDeg){
+    if (!gOps.shapes) return -1;
+    if (gOps.nAdd == gOps.addCap){
+        int cap = gOps.addCap ? gOps.addCap * 2 : 16;
+        PendingShape *a = (PendingShape*)realloc(gOps.add, sizeof(PendingShape) * cap);
+        if (!a) return -1;
+        gOps.add = a; gOps.addCap = cap;
     }
-
-    for (int tries=0; tries<2048; ++tries){
-        float x = (float)GetRandomValue((int)BALL_RADIUS_MIN, (int)(sw - BALL_RADIUS_MIN));
-        float y = (float)GetRandomValue((int)BALL_RADIUS_MIN, (int)(sh - BALL_RADIUS_MIN));
-        if (!CenterInsideAnyShape(shapes, n, x, y)){ b->x = x; b->y = y; return; }
-    }
-    b->x = sw*0.5f; b->y = BALL_RADIUS_MAX + SPAWN_MARGIN;
-    for (int i=0;i<n;++i) PushOutsideHull(&shapes[i], b->r, &b->x, &b->y);
+    int h = ShapePoolNewHandle(gOps.shapes);
+    if (h < 0) return -1;
+    ShapeType t = (type == SHAPE_SQUARE || type == SHAPE_POLYGON) ? (ShapeType)type : SHAPE_CIRCLE;
+    gOps.add[gOps.nAdd++] = (PendingShape){ h, (ShapeInit){ t, x, y, size, angleDeg, -1, TEX_FIT_COVER, WHITE, 0, NULL } };
+    return h;
 }
-
-// ----- Ball vs. shape collision -----
-static inline void ResolveCircleVsSquare(const Shape *sq, float radius, float *bx, float *by, float *vx, float *vy){
-    const float PI_F = 3.14159265358979323846f;
-    float a = sq->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
-
-    Vector2 pW = (Vector2){ *bx - sq->x, *by - sq->y };
-    Vector2 vW = (Vector2){ *vx, *vy };
-    Vector2 pL = InvRotateCS(pW, c, s);
-    Vector2 vL = InvRotateCS(vW, c, s);
-
-    float h = sq->half;
-    float cx = (pL.x < -h) ? -h : (pL.x >  h) ?  h : pL.x;
-    float cy = (pL.y < -h) ? -h : (pL.y >  h) ?  h : pL.y;
-
-    float dx = pL.x - cx, dy = pL.y - cy;
-    float dist2 = dx*dx + dy*dy;
-
-    if (dist2 <= radius*radius){
-        float dist = (dist2 > 0.0f) ? sqrtf(dist2) : 0.0f;
-        Vector2 nL = (dist > 1.0f)? (Vector2){ dx/dist, dy/dist }
-                                  : (fabsf(vL.x) > fabsf(vL.y)) ? (Vector2){ (vL.x>0.0f)?1.0f:-1.0f, 0.0f }
-                                                                 : (Vector2){ 0.0f, (vL.y>0.0f)?1.0f:-1.0f };
-        float penetration = (radius - dist) + SEP_BIAS; if (penetration < 0.0f) penetration = 0.0f;
-        Vector2 nW = RotateCS(nL, c, s);
-        *bx += nW.x * penetration; *by += nW.y * penetration;
-
-        Vector2 vRef = Reflect((Vector2){ *vx, *vy }, nW);
-        *vx = vRef.x; *vy = vRef.y;
-
-        *bx += (*vx) * (1.0f/8000.0f);
-        *by += (*vy) * (1.0f/8000.0f);
+APP_API void AppAddShapes(int n){
+    const int sw = GetScreenWidth(), sh = GetScreenHeight();
+    const int total = AppShapeCount() + gOps.nAdd + n;
+    for (int i=0;i<n;++i){
+        ShapeInit S = ScatteredShapeInit(sw, sh, total);
+        if (AppAddShape(S.type, S.x, S.y, S.size, S.angle) < 0) break;
     }
 }
-static inline void ResolveCircleVsCircle(const Shape *sc, float radius, float *bx, float *by, float *vx, float *vy){
-    float dx = *bx - sc->x, dy = *by - sc->y;
-    float rSum = radius + sc->radius;
-    float d2   = dx*dx + dy*dy;
-    if (d2 <= rSum*rSum){
-        float d = (d2>0.0f)? sqrtf(d2) : 0.0f;
-        Vector2 n = (d>1.0e-6f)? (Vector2){ dx/d, dy/d }
-                               : (fabsf(*vx) > fabsf(*vy)) ? (Vector2){ (*vx>0.0f)?1.0f:-1.0f, 0.0f }
-                                                           : (Vector2){ 0.0f, (*vy>0.0f)?1.0f:-1.0f };
-        float penetration = (rSum - d) + SEP_BIAS; if (penetration < 0.0f) penetration = 0.0f;
-        *bx += n.x * penetration; *by += n.y * penetration;
-
-        Vector2 vRef = Reflect((Vector2){ *vx, *vy }, n);
-        *vx = vRef.x; *vy = vRef.y;
-
-        *bx += (*vx) * (1.0f/8000.0f);
-        *by += (*vy) * (1.0f/8000.0f);
+APP_API void AppRemoveShape(int handle){
+    if (gOps.nRemove == gOps.removeCap){
+        int cap = gOps.removeCap ? gOps.removeCap * 2 : 16;
+        int *r = (int*)realloc(gOps.remove, sizeof(int) * cap);
+        if (!r) return;
+        gOps.remove = r; gOps.removeCap = cap;
     }
+    gOps.remove[gOps.nRemove++] = handle;
 }
-static inline void ResolveCircleVsShape(const Shape *sh, float radius, float *bx, float *by, float *vx, float *vy){
-    if (sh->type==SHAPE_SQUARE) ResolveCircleVsSquare(sh, radius, bx, by, vx, vy);
-    else                        ResolveCircleVsCircle(sh, radius, bx, by, vx, vy);
-}
+APP_API void AppRemoveShapes(int n){ if (n > 0) gOps.removeTop += n; }
 
 // ----- Web callbacks -----
 #ifdef PLATFORM_WEB
@@ -563,49 +347,6 @@ static void DrawAudioGUI(void){
 #endif
 }
 
-// ----- Drawing helper -----
-static void DrawShapeWithTexture(const Shape *sh){
-    if (sh->type == SHAPE_SQUARE){
-        float sideNow = sh->half * 2.0f;
-        if (TextureIndexOk(sh->texId)){
-            Texture2D tex = gTextures[sh->texId];
-            float sx = (float)tex.width, sy = (float)tex.height;
-            float sCover   = fmaxf(sideNow/sx, sideNow/sy);
-            float sContain = fminf(sideNow/sx, sideNow/sy);
-            float scale = (sh->fit == TEX_FIT_COVER) ? sCover : sContain;
-            Rectangle src  = (Rectangle){0,0,sx,sy};
-            Rectangle dest = (Rectangle){sh->x, sh->y, sx*scale, sy*scale};
-            Vector2   org  = (Vector2){dest.width*0.5f, dest.height*0.5f};
-            DrawTexturePro(tex, src, dest, org, sh->angle, sh->tint);
-        } else {
-            DrawRectanglePro((Rectangle){ sh->x, sh->y, sideNow, sideNow },
-                             (Vector2){ sh->half, sh->half }, sh->angle, (Color){230,230,230,255});
-        }
-#if DEBUG_DRAW
-        DrawCircleLines((int)sh->x, (int)sh->y, (int)ShapeHullRadius(sh), (Color){255,0,0,80});
-#endif
-    } else { // circle
-        float d = sh->radius * 2.0f;
-        if (TextureIndexOk(sh->texId)){
-            Texture2D tex = gTextures[sh->texId];
-            float sx = (float)tex.width, sy = (float)tex.height;
-            float sCover   = fmaxf(d/sx, d/sy);
-            float sContain = fminf(d/sx, d/sy);
-            float scale    = (sh->fit == TEX_FIT_COVER) ? sCover : sContain;
-            Rectangle src  = (Rectangle){ 0, 0, sx, sy };
-            Rectangle dest = (Rectangle){ sh->x, sh->y, sx*scale, sy*scale };
-            Vector2   org  = (Vector2){ dest.width*0.5f, dest.height*0.5f };
-            float     ang  = ROTATE_TEXTURES ? sh->angle : 0.0f;
-            DrawTexturePro(tex, src, dest, org, ang, sh->tint);
-        } else {
-            DrawCircleV(V2(sh->x, sh->y), sh->radius, (Color){245,245,245,255});
-        }
-#if DEBUG_DRAW
-        DrawCircleLines((int)sh->x, (int)sh->y, (int)sh->radius, RED);
-#endif
-    }
-}
-
 #ifdef PLATFORM_WEB
 // ----- Resize callback (file scope) -----
 static EM_BOOL OnResize(int eventType, const EmscriptenUiEvent *ui, void *userData){
@@ -620,14 +361,16 @@ static EM_BOOL OnResize(int eventType, const EmscriptenUiEvent *ui, void *userDa
 
     const float sw = (float)GetScreenWidth();
     const float sh = (float)GetScreenHeight();
-    for (int i=0;i<s->ballCount;++i){
-        Ball *b = &s->balls[i];
-        if (b->x < b->r) b->x = b->r;
-        if (b->y < b->r) b->y = b->r;
-        if (b->x > sw - b->r) b->x = sw - b->r;
-        if (b->y > sh - b->r) b->y = sh - b->r;
-        b->trappedFrames = 0;
+    BallStore *bs = s->balls;
+    for (int i=0;i<bs->count;++i){
+        float r = bs->r[i];
+        if (bs->x[i] < r) bs->x[i] = r;
+        if (bs->y[i] < r) bs->y[i] = r;
+        if (bs->x[i] > sw - r) bs->x[i] = sw - r;
+        if (bs->y[i] > sh - r) bs->y[i] = sh - r;
+        bs->px[i] = bs->x[i]; bs->py[i] = bs->y[i];
     }
+    bs->awake = bs->count;   // walls moved under the sleepers
     return EM_TRUE;
 }
 #endif
@@ -638,6 +381,11 @@ int main(void){
     InitWindow(1024, 600, "raylib: Shapes + balls + textures");
     SetTargetFPS(90);
     SetTraceLogLevel(LOG_DEBUG);
+#if DETERMINISTIC
+    SimRngSeed(SIM_SEED);
+#else
+    SimRngSeed(((uint64_t)(uint32_t)GetRandomValue(0, 0x7fffffff) << 32) | (uint32_t)GetRandomValue(0, 0x7fffffff));
+#endif
 
     LoadTextureBank();
 
@@ -654,37 +402,15 @@ int main(void){
     const int shInit = GetScreenHeight();
 
     // ----- Build shapes from preset -----
-    Shape shapes[NUM_SHAPES] = {0};
+    ShapePool shapePool = {0};
+    if (!ShapePoolReserve(&shapePool, NUM_SHAPES)){ CloseWindow(); return 1; }
     for (int i=0;i<NUM_SHAPES;++i){
-        const ShapeInit *S = &SHAPES_PRESET[i];
-        shapes[i].type  = S->type;
-        shapes[i].x     = S->x;
-        shapes[i].y     = S->y;
-        shapes[i].angle = S->angle;
-        shapes[i].texId = (S->texId >= 0 && S->texId < TEX_COUNT && TextureOk(gTextures[S->texId])) ? S->texId : -1;
-        shapes[i].fit   = S->fit;
-        shapes[i].tint  = S->tint;
-        if (S->type == SHAPE_SQUARE){
-            float side = (S->size <= 0 ? 160.0f : S->size);
-            if (side < SQUARE_MIN_SIDE) side = SQUARE_MIN_SIDE;
-            if (side > SQUARE_MAX_SIDE) side = SQUARE_MAX_SIDE;
-            shapes[i].half   = side * 0.5f;
-            shapes[i].radius = 0.0f;
-        } else {
-            float diam = (S->size <= 0 ? 160.0f : S->size);
-            float r = diam * 0.5f;
-            if (r < CIRCLE_R_MIN) r = CIRCLE_R_MIN;
-            if (r > CIRCLE_R_MAX) r = CIRCLE_R_MAX;
-            shapes[i].radius = r;
-            shapes[i].half   = 0.0f;
-        }
+        ShapeInit S = (i < PRESET_COUNT) ? SHAPES_PRESET[i] : ScatteredShapeInit(swInit, shInit, NUM_SHAPES);
+        ShapePoolAdd(&shapePool, ShapeFromInit(&S));
     }
 
-    // Pinch bases
-    float pinchBaseDist[NUM_SHAPES]={0}, pinchBaseSide[NUM_SHAPES]={0}, pinchBaseAngleDeg[NUM_SHAPES]={0}, pinchStartVecDeg[NUM_SHAPES]={0};
-    for (int i=0;i<NUM_SHAPES;++i){
-        pinchBaseSide[i] = (shapes[i].type==SHAPE_SQUARE)? (shapes[i].half*2.0f):(shapes[i].radius*2.0f);
-    }
+    // Pinch bases (only one shape is pinched at a time)
+    float pinchBaseDist = 0.0f, pinchBaseSide = 0.0f, pinchBaseAngleDeg = 0.0f, pinchStartVecDeg = 0.0f;
 
     // Input state
     TrackedTouch t0 = (TrackedTouch){ .id = -1, .pos = (Vector2){0} };
@@ -698,24 +424,223 @@ int main(void){
     int pinchActive       = 0;
 
     // Balls
-    Ball *balls = (Ball*)malloc(sizeof(Ball) * NUM_BALLS);
-    if (!balls){ CloseWindow(); return 1; }
+    BallStore balls;
+#if COMPACT_BALLS
+    BallPackedStore packed = { .sw = (float)swInit, .sh = (float)shInit };   // every ball; `balls` is the sim chunk
+    int    ballScratchCap = COMPACT_CHUNK;
+    BallLutsInit();
+#else
+    int    ballScratchCap = NUM_BALLS;   // per-ball sim scratch, grown with balls.cap
+#endif
+    int   *ballSteps  = (int*)malloc(sizeof(int) * ballScratchCap);
+    float *ballSdt    = (float*)malloc(sizeof(float) * ballScratchCap);
+    float *ballReach  = (float*)malloc(sizeof(float) * ballScratchCap);
+    SimSlice slices[SIM_THREADS];
+    for (int si=0; si<SIM_THREADS; ++si) SimSliceInit(&slices[si]);
+    ShapeTable *shapeTab  = (ShapeTable*)calloc(1, sizeof(ShapeTable));
+    ShapeTable *shapePrev = (ShapeTable*)calloc(1, sizeof(ShapeTable));   // table at the last sim step: sleeper wakes, shape motion
+    ShapeSap   *shapeSap  = (ShapeSap*)calloc(1, sizeof(ShapeSap));
+    if (!BallStoreInit(&balls, ballScratchCap) || !ballSteps || !ballSdt || !ballReach || !shapeTab || !shapePrev || !shapeSap){ CloseWindow(); return 1; }
+    for (int i=0;i<shapePool.count;++i) ShapeSapAdd(shapeSap);
+    gOps.shapes = &shapePool;
+#if COMPACT_BALLS
+    gOps.ballTotal = &packed.count;
+#else
+    gOps.ballTotal = &balls.count;
+#endif
+    SpawnMap spawnMap = {0};
+    SpawnMap *spawnUse = FREE_SPACE_SPAWN ? &spawnMap : NULL;
     {
-        float seedX = swInit * 0.5f, seedY = shInit * 0.5f;
-        for (int i=0;i<NUM_BALLS;++i) RespawnBallOutsideAllShapes(&balls[i], shapes, NUM_SHAPES, seedX, seedY);
+        double spawnT0 = GetTime();
+        ShapeTableBuild(shapeTab, shapePool.items, shapePool.count);
+        if (FREE_SPACE_SPAWN) SpawnMapUpdate(&spawnMap, shapeTab, swInit, shInit);
+#if COMPACT_BALLS
+        BallsPackedSetCount(&packed, &balls, NUM_BALLS, shapeTab, spawnUse, swInit, shInit);
+#else
+        BallsSetCount(&balls, NUM_BALLS, shapeTab, spawnUse, swInit, shInit);
+#endif
+        ShapeTableCopy(shapePrev, shapeTab);
+        TraceLog(LOG_INFO, "SPAWN: %d balls in %.2f ms (%s, %d open cells)", AppBallCount(),
+                 (GetTime() - spawnT0) * 1000.0, FREE_SPACE_SPAWN ? "free-space" : "rejection", spawnMap.atLeast[1]);
     }
 
-#ifdef PLATFORM_WEB
-    AppState state = { .dummy=NULL, .balls=balls, .ballCount=NUM_BALLS };
+    SimPoolStart();
+    BallRenderer ballRenderer;
+    BallRendererInit(&ballRenderer);
+#if RENDER_BENCH
+    BallRendererBench(&ballRenderer, RENDER_BENCH);
+#endif
+
+#if defined(PLATFORM_WEB) && !DETERMINISTIC   // replays keep the 1024x600 canvas
+    AppState state = { .dummy=NULL, .balls=&balls };
     OnResize(0, NULL, &state);
     emscripten_set_resize_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, &state, EM_TRUE, OnResize);
 #endif
+#if DETERMINISTIC
+    TraceLog(LOG_INFO, "DETERMINISTIC: seed %llu, %dx%d, %d Hz, %d balls, %d shapes",
+             (unsigned long long)SIM_SEED, swInit, shInit, SIM_HZ, balls.count, shapePool.count);
+    uint64_t  simHash  = SimStateHash(&balls, shapePool.items, shapePool.count);
+    long long simStepN = 0;
+    TraceLog(LOG_INFO, "HASH step 0: %016llx", (unsigned long long)simHash);
+#endif
+
+    ShapeGrid grid = {0};
+    ShapeGrid hitGrid = {0};   // pointer hit-tests; rebuilt with the shape table each frame
+    ShapeGridBuildHit(&hitGrid, shapePool.items, shapePool.count, swInit, shInit, HIT_CELL_PX, HIT_PAD);
+#if HIT_BENCH
+    {
+        float *qx = (float*)malloc(sizeof(float) * HIT_BENCH);
+        float *qy = (float*)malloc(sizeof(float) * HIT_BENCH);
+        for (int q=0;q<HIT_BENCH;++q){ qx[q] = (float)GetRandomValue(0, swInit); qy[q] = (float)GetRandomValue(0, shInit); }
+        double t0 = GetTime();
+        ShapeGridBuildHit(&hitGrid, shapePool.items, shapePool.count, swInit, shInit, HIT_CELL_PX, HIT_PAD);
+        double t1 = GetTime();
+        long long sumLin = 0, sumGrid = 0;   // keeps the loops from being optimised out
+        for (int q=0;q<HIT_BENCH;++q) sumLin += TopShapeAt(qx[q], qy[q], shapePool.items, shapePool.count);
+        double t2 = GetTime();
+        for (int q=0;q<HIT_BENCH;++q) sumGrid += ShapeGridTopAt(&hitGrid, shapePool.items, qx[q], qy[q]);
+        double t3 = GetTime();
+        int mismatch = 0;
+        for (int q=0;q<HIT_BENCH;++q) mismatch += TopShapeAt(qx[q], qy[q], shapePool.items, shapePool.count) != ShapeGridTopAt(&hitGrid, shapePool.items, qx[q], qy[q]);
+        TraceLog(LOG_INFO, "HITBENCH: %d shapes, %d queries: linear %.3f us, grid %.3f us per query; build %.3f ms; %d mismatches (%lld/%lld)",
+                 shapePool.count, HIT_BENCH, (t2 - t1) * 1e6 / HIT_BENCH, (t3 - t2) * 1e6 / HIT_BENCH, (t1 - t0) * 1e3,
+                 mismatch, sumLin, sumGrid);
+        free(qx); free(qy);
+    }
+#endif
+#if SDF_BENCH
+    {
+        // Query points scattered over each silhouette's hull box; the same
+        // shape compiled without its SDF gives the analytic outline cost.
+        float *qx = (float*)malloc(sizeof(float) * SDF_BENCH);
+        float *qy = (float*)malloc(sizeof(float) * SDF_BENCH);
+        int   *qk = (int*)malloc(sizeof(int) * SDF_BENCH);
+        int nSdf = 0;
+        for (int k=0;k<shapeTab->n;++k) nSdf += (shapeTab->k[k].sdf != NULL);
+        if (nSdf > 0){
+            for (int q=0, k=0; q<SDF_BENCH; ++q){
+                while (!shapeTab->k[k].sdf) k = (k + 1) % shapeTab->n;
+                const ShapeCompiled *sk = &shapeTab->k[k];
+                qk[q] = k;
+                qx[q] = sk->x + sk->hull * (float)GetRandomValue(-1000, 1000) / 1000.0f;
+                qy[q] = sk->y + sk->hull * (float)GetRandomValue(-1000, 1000) / 1000.0f;
+                k = (k + 1) % shapeTab->n;
+            }
+            ShapeCompiled *plain = (ShapeCompiled*)malloc(sizeof(ShapeCompiled) * shapeTab->n);
+            memcpy(plain, shapeTab->k, sizeof(ShapeCompiled) * shapeTab->n);
+            for (int k=0;k<shapeTab->n;++k) plain[k].sdf = NULL;
+            double t0 = GetTime();
+            float sumSdf = 0.0f, sumPlain = 0.0f;   // keeps the loops from being optimised out
+            for (int q=0;q<SDF_BENCH;++q){ float nx, ny; sumSdf += CompiledSdf(&shapeTab->k[qk[q]], qx[q], qy[q], &nx, &ny) + nx; }
+            double t1 = GetTime();
+            for (int q=0;q<SDF_BENCH;++q) sumPlain += CompiledDistance(&plain[qk[q]], qx[q], qy[q]);
+            double t2 = GetTime();
+            int inside = 0;
+            for (int q=0;q<SDF_BENCH;++q) inside += CompiledPointIn(&shapeTab->k[qk[q]], qx[q], qy[q]);
+            TraceLog(LOG_INFO, "SDFBENCH: %d silhouettes, %d queries: sdf %.1f ns, outline %.1f ns per query; %.1f%% inside (%.0f/%.0f)",
+                     nSdf, SDF_BENCH, (t1 - t0) * 1e9 / SDF_BENCH, (t2 - t1) * 1e9 / SDF_BENCH,
+                     100.0 * inside / SDF_BENCH, sumSdf, sumPlain);
+            free(plain);
+        }
+        free(qx); free(qy); free(qk);
+    }
+#endif
+#if BALL_BALL_COLLIDE
+    BallHash      ballHash = {0};
+    BallBallStats bbStats  = {0};
+    (void)bbStats;   // only read by the stats overlay and the bench log
+#endif
+
+#if SHOW_STATS || SIM_BENCH_FRAMES
+    double statSimMs = 0.0, statSimMsSum = 0.0, statSimMsMax = 0.0;
+    int    statFrames = 0;
+    long long statContactSteps = 0, statTunnel = 0, statTrapped = 0, statRespawned = 0;   // per contact ball per step
+#if KINEMATIC_SHAPES
+    long long statPlowed = 0;
+#endif
+    long long statSteps = 0;
+#if SUBSTEP_BUCKETS
+    long long statBucketBalls[STEP_BUCKETS] = {0};
+    double    statBucketMs[STEP_BUCKETS]    = {0};
+#endif
+    double    statWallT0 = GetTime(), statBallDrawMs = 0.0, statTinyMs = 0.0;
+    long long statTinyBalls = 0;
+#endif
+#if FIXED_TIMESTEP && !DETERMINISTIC
+    float simAccum = 0.0f;
+#endif
+#if KINEMATIC_SHAPES
+    float shapeAge = 0.0f;   // seconds since shapePrev was taken
+#endif
+#if BALL_SLEEP
+    int sleepSw = swInit, sleepSh = shInit;
+#endif
 
     while (!WindowShouldClose()){
         const float dt   = GetFrameTime();
         const int   swWin = GetScreenWidth();
         const int   shWin = GetScreenHeight();
 
+        // ---------- Operator requests (pool resizes happen only here) ----------
+        if (gOps.reserveShapes > 0){
+            ShapePoolReserve(&shapePool, gOps.reserveShapes);
+            ShapeTableReserve(shapeTab, gOps.reserveShapes);
+            ShapeTableReserve(shapePrev, gOps.reserveShapes);
+            ShapeSapReserve(shapeSap, gOps.reserveShapes);
+            gOps.reserveShapes = 0;
+        }
+        if (gOps.reserveBalls > 0){
+#if COMPACT_BALLS
+            BallPackedReserve(&packed, gOps.reserveBalls);
+#else
+            BallStoreReserve(&balls, gOps.reserveBalls);
+#endif
+            gOps.reserveBalls = 0;
+        }
+        if (gOps.nAdd > 0 || gOps.nRemove > 0 || gOps.removeTop > 0){
+            for (int q=0;q<gOps.nAdd;++q){
+                Shape sh = ShapeFromInit(&gOps.add[q].init);
+                if (ShapePoolPlace(&shapePool, gOps.add[q].handle, sh) >= 0) ShapeSapAdd(shapeSap);
+            }
+            for (int q=0; q<gOps.nRemove + gOps.removeTop; ++q){
+                int h;
+                if (q < gOps.nRemove) h = gOps.remove[q];
+                else if (shapePool.count > 0) h = shapePool.handleOf[shapePool.count - 1];
+                else break;
+                const int last = shapePool.count - 1;
+                const int idx  = ShapePoolRemove(&shapePool, h);
+                if (idx < 0) continue;
+                ShapeSapRemove(shapeSap, idx);
+                RemapShapeIndex(&dragMouseShape, idx, last);
+                RemapShapeIndex(&rotateMouseShape, idx, last);
+                RemapShapeIndex(&dragTouchShape, idx, last);
+                RemapShapeIndex(&pinchShape, idx, last);
+                if (pinchShape == -1) pinchActive = 0;
+            }
+            gOps.nAdd = gOps.nRemove = gOps.removeTop = 0;
+            // New balls below spawn against the edited shapes
+            ShapeTableBuild(shapeTab, shapePool.items, shapePool.count);
+            shapePrev->n = 0;   // indices were reused: no motion across the edit, wake everyone
+            if (FREE_SPACE_SPAWN) SpawnMapUpdate(&spawnMap, shapeTab, swWin, shWin);
+        }
+        if (gOps.ballCount >= 0){
+#if COMPACT_BALLS
+            BallsPackedSetCount(&packed, &balls, gOps.ballCount, shapeTab, spawnUse, swWin, shWin);
+#else
+            BallsSetCount(&balls, gOps.ballCount, shapeTab, spawnUse, swWin, shWin);
+#endif
+            gOps.ballCount = -1;
+        }
+        if (balls.cap > ballScratchCap){
+            int   *st = (int*)realloc(ballSteps, sizeof(int) * balls.cap);     if (st) ballSteps = st;
+            float *sd = (float*)realloc(ballSdt, sizeof(float) * balls.cap);   if (sd) ballSdt   = sd;
+            float *re = (float*)realloc(ballReach, sizeof(float) * balls.cap); if (re) ballReach = re;
+            if (st && sd && re) ballScratchCap = balls.cap;
+        }
+        if (balls.count > ballScratchCap) BallsSetCount(&balls, ballScratchCap, shapeTab, spawnUse, swWin, shWin);
+        Shape    *shapes  = shapePool.items;
+        const int nShapes = shapePool.count;
+
         // ---------- INPUT ----------
         int touchCount = GetTouchPointCount();
 
@@ -724,14 +649,14 @@ int main(void){
 
             if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)){
                 gGestureOk = 1;
-                int top = TopShapeAt(mpos.x, mpos.y, shapes, NUM_SHAPES);
+                int top = ShapeGridTopAt(&hitGrid, shapes, mpos.x, mpos.y);
                 dragMouseShape = top;
                 if (dragMouseShape != -1) PlayTapInForShape(&shapes[dragMouseShape]); else { EnsureAudioReady(); PlaySound(gTapIn); }
             }
             if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)){
-                int idx = (dragMouseShape != -1) ? dragMouseShape : TopShapeAt(mpos.x, mpos.y, shapes, NUM_SHAPES);
+                int idx = (dragMouseShape != -1) ? dragMouseShape : ShapeGridTopAt(&hitGrid, shapes, mpos.x, mpos.y);
                 if (idx < 0) idx = 0;
-                PlayTapOutForShape(&shapes[idx]);
+                if (idx < nShapes) PlayTapOutForShape(&shapes[idx]);
                 dragMouseShape = -1;
             }
             if (dragMouseShape != -1 && IsMouseButtonDown(MOUSE_LEFT_BUTTON)){
@@ -744,13 +669,13 @@ int main(void){
 
             if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)){
                 gGestureOk = 1;
-                rotateMouseShape = TopShapeAt(mpos.x, mpos.y, shapes, NUM_SHAPES);
+                rotateMouseShape = ShapeGridTopAt(&hitGrid, shapes, mpos.x, mpos.y);
                 if (rotateMouseShape != -1) PlayTapInForShape(&shapes[rotateMouseShape]); else { EnsureAudioReady(); PlaySound(gTapIn); }
             }
             if (IsMouseButtonReleased(MOUSE_RIGHT_BUTTON)){
-                int idx = (rotateMouseShape != -1) ? rotateMouseShape : TopShapeAt(mpos.x, mpos.y, shapes, NUM_SHAPES);
+                int idx = (rotateMouseShape != -1) ? rotateMouseShape : ShapeGridTopAt(&hitGrid, shapes, mpos.x, mpos.y);
                 if (idx < 0) idx = 0;
-                PlayTapOutForShape(&shapes[idx]);
+                if (idx < nShapes) PlayTapOutForShape(&shapes[idx]);
                 rotateMouseShape = -1;
             }
             if (rotateMouseShape != -1 && IsMouseButtonDown(MOUSE_RIGHT_BUTTON)){
@@ -760,14 +685,14 @@ int main(void){
 
             float wheel = GetMouseWheelMove();
             if (wheel != 0.0f){
-                int idx = TopShapeAt(mpos.x, mpos.y, shapes, NUM_SHAPES);
-                if (idx < 0) idx = NUM_SHAPES-1;
-                if (shapes[idx].type==SHAPE_SQUARE){
+                int idx = ShapeGridTopAt(&hitGrid, shapes, mpos.x, mpos.y);
+                if (idx < 0) idx = nShapes-1;
+                if (idx >= 0 && shapes[idx].type==SHAPE_SQUARE){
                     float side = shapes[idx].half * 2.0f + wheel * 8.0f;
                     if (side < SQUARE_MIN_SIDE) side = SQUARE_MIN_SIDE;
                     if (side > SQUARE_MAX_SIDE) side = SQUARE_MAX_SIDE;
                     shapes[idx].half = side * 0.5f;
-                } else {
+                } else if (idx >= 0){
                     float r = shapes[idx].radius + wheel * 8.0f;
                     if (r < CIRCLE_R_MIN) r = CIRCLE_R_MIN;
                     if (r > CIRCLE_R_MAX) r = CIRCLE_R_MAX;
@@ -789,7 +714,7 @@ int main(void){
                 const TrackedTouch *a = (t0.id != -1)? &t0 : &t1;
                 if (prevTouchCount == 0){
                     gGestureOk = 1;
-                    dragTouchShape = TopShapeAt(a->pos.x, a->pos.y, shapes, NUM_SHAPES);
+                    dragTouchShape = ShapeGridTopAt(&hitGrid, shapes, a->pos.x, a->pos.y);
                     if (dragTouchShape != -1) PlayTapInForShape(&shapes[dragTouchShape]); else { EnsureAudioReady(); PlaySound(gTapIn); }
                 }
                 if (dragTouchShape != -1){
@@ -805,10 +730,10 @@ int main(void){
                 if (prevTouchCount < 2 && pinchShape == -1){
                     gGestureOk = 1;
                     Vector2 c = (Vector2){ (t0.pos.x+t1.pos.x)*0.5f, (t0.pos.y+t1.pos.y)*0.5f };
-                    int sIdx = TopShapeAt(c.x, c.y, shapes, NUM_SHAPES);
+                    int sIdx = ShapeGridTopAt(&hitGrid, shapes, c.x, c.y);
                     if (sIdx < 0){
-                        int a = TopShapeAt(t0.pos.x, t0.pos.y, shapes, NUM_SHAPES);
-                        int b = TopShapeAt(t1.pos.x, t1.pos.y, shapes, NUM_SHAPES);
+                        int a = ShapeGridTopAt(&hitGrid, shapes, t0.pos.x, t0.pos.y);
+                        int b = ShapeGridTopAt(&hitGrid, shapes, t1.pos.x, t1.pos.y);
                         sIdx = (a>=0)? a : b;
                     }
                     pinchShape = sIdx;
@@ -835,14 +760,14 @@ int main(void){
 
                     int havePrevPair = ((t0.id == prev0.id && t1.id == prev1.id) || (t0.id == prev1.id && t1.id == prev0.id));
                     if (!havePrevPair || prevTouchCount < 2){
-                        pinchBaseDist[pinchShape]     = (currDist > 0.0f) ? currDist : 1.0f;
-                        pinchBaseSide[pinchShape]     = (sh->type==SHAPE_SQUARE)? (sh->half*2.0f):(sh->radius*2.0f);
-                        pinchBaseAngleDeg[pinchShape] = sh->angle;
-                        pinchStartVecDeg[pinchShape]  = currAngDeg;
+                        pinchBaseDist     = (currDist > 0.0f) ? currDist : 1.0f;
+                        pinchBaseSide     = (sh->type==SHAPE_SQUARE)? (sh->half*2.0f):(sh->radius*2.0f);
+                        pinchBaseAngleDeg = sh->angle;
+                        pinchStartVecDeg  = currAngDeg;
                         pinchActive = 1;
                     } else if (pinchActive){
-                        if (currDist > 0.0f && pinchBaseDist[pinchShape] > 0.0f){
-                            float side = pinchBaseSide[pinchShape] * (currDist / pinchBaseDist[pinchShape]);
+                        if (currDist > 0.0f && pinchBaseDist > 0.0f){
+                            float side = pinchBaseSide * (currDist / pinchBaseDist);
                             if (sh->type==SHAPE_SQUARE){
                                 if (side < SQUARE_MIN_SIDE) side = SQUARE_MIN_SIDE;
                                 if (side > SQUARE_MAX_SIDE) side = SQUARE_MAX_SIDE;
@@ -855,10 +780,10 @@ int main(void){
                             }
                         }
 #if ROTATE_TEXTURES
-                        float delta = currAngDeg - pinchStartVecDeg[pinchShape];
+                        float delta = currAngDeg - pinchStartVecDeg;
                         while (delta > 180.0f)  delta -= 360.0f;
                         while (delta < -180.0f) delta += 360.0f;
-                        sh->angle = pinchBaseAngleDeg[pinchShape] + delta;
+                        sh->angle = pinchBaseAngleDeg + delta;
 #endif
                     }
                 }
@@ -869,25 +794,23 @@ int main(void){
                 if (dragTouchShape != -1) idx = dragTouchShape;
                 else if (pinchShape != -1) idx = pinchShape;
                 if (idx < 0) idx = 0;
-                PlayTapOutForShape(&shapes[idx]);
+                if (idx < nShapes) PlayTapOutForShape(&shapes[idx]);
             }
             prevTouchCount = effectiveCount;
         }
 
-        // Clamp shapes inside window
-        for (int i=0;i<NUM_SHAPES;++i){
-            if (shapes[i].type==SHAPE_SQUARE){
-                if (shapes[i].x < shapes[i].half) shapes[i].x = shapes[i].half;
-                if (shapes[i].y < shapes[i].half) shapes[i].y = shapes[i].half;
-                if (shapes[i].x > swWin - shapes[i].half) shapes[i].x = swWin - shapes[i].half;
-                if (shapes[i].y > shWin - shapes[i].half) shapes[i].y = shWin - shapes[i].half;
-            } else {
-                if (shapes[i].x < shapes[i].radius) shapes[i].x = shapes[i].radius;
-                if (shapes[i].y < shapes[i].radius) shapes[i].y = shapes[i].radius;
-                if (shapes[i].x > swWin - shapes[i].radius) shapes[i].x = swWin - shapes[i].radius;
-                if (shapes[i].y > shWin - shapes[i].radius) shapes[i].y = shWin - shapes[i].radius;
-            }
+#if DRAG_BENCH
+        // Scripted fast drag: shape 0 ping-pongs across the window at a fixed
+        // rate per frame, plowing through the resting field.
+        if (nShapes > 0){
+            static int dragFrame = 0;
+            float span = (float)swWin, pos = fmodf((float)dragFrame++ * (float)DRAG_BENCH / 60.0f, 2.0f * span);
+            shapes[0].x = (pos < span) ? pos : 2.0f * span - pos;
+            shapes[0].y = (float)shWin * 0.5f;
         }
+#endif
+        // Clamp shapes inside window
+        for (int i=0;i<nShapes;++i) ClampShapeToWindow(&shapes[i], (float)swWin, (float)shWin);
 
 #if SHAPE_SHAPE_PUSH
         // Shape↔shape pushing (bounding-circle based)
@@ -896,101 +819,177 @@ int main(void){
         else if (rotateMouseShape != -1) activeIdxPush = rotateMouseShape;
         else if (dragTouchShape   != -1) activeIdxPush = dragTouchShape;
         else if (dragMouseShape   != -1) activeIdxPush = dragMouseShape;
+        if (DRAG_BENCH) activeIdxPush = 0;
 
-        for (int pass=0; pass<2; ++pass){
-            for (int i=0;i<NUM_SHAPES;++i){
-                for (int j=i+1;j<NUM_SHAPES;++j){
-                    float ri = ShapeHullRadius(&shapes[i]);
-                    float rj = ShapeHullRadius(&shapes[j]);
-                    float dx = shapes[j].x - shapes[i].x;
-                    float dy = shapes[j].y - shapes[i].y;
-                    float d2 = dx*dx + dy*dy;
-                    float need = ri + rj + 0.001f;
-                    if (d2 < need*need){
-                        float d = (d2>1e-8f)? sqrtf(d2) : 0.0f;
-                        float nx = (d>1e-8f)? (dx/d) : 1.0f;
-                        float ny = (d>1e-8f)? (dy/d) : 0.0f;
-                        float pen = need - d;
-
-                        float wi = (i==activeIdxPush) ? 0.25f : 0.5f;
-                        float wj = (j==activeIdxPush) ? 0.25f : 0.5f;
-                        float sum = wi + wj; wi/=sum; wj/=sum;
-
-                        shapes[i].x -= nx * pen * wi;
-                        shapes[i].y -= ny * pen * wi;
-                        shapes[j].x += nx * pen * wj;
-                        shapes[j].y += ny * pen * wj;
-
-                        // re-clamp
-                        if (shapes[i].type==SHAPE_SQUARE){
-                            float h=shapes[i].half;
-                            if (shapes[i].x < h) shapes[i].x = h;
-                            if (shapes[i].y < h) shapes[i].y = h;
-                            if (shapes[i].x > swWin-h) shapes[i].x = swWin-h;
-                            if (shapes[i].y > shWin-h) shapes[i].y = shWin-h;
-                        } else {
-                            float r=shapes[i].radius;
-                            if (shapes[i].x < r) shapes[i].x = r;
-                            if (shapes[i].y < r) shapes[i].y = r;
-                            if (shapes[i].x > swWin-r) shapes[i].x = swWin-r;
-                            if (shapes[i].y > shWin-r) shapes[i].y = shWin-r;
-                        }
-                        if (shapes[j].type==SHAPE_SQUARE){
-                            float h=shapes[j].half;
-                            if (shapes[j].x < h) shapes[j].x = h;
-                            if (shapes[j].y < h) shapes[j].y = h;
-                            if (shapes[j].x > swWin-h) shapes[j].x = swWin-h;
-                            if (shapes[j].y > shWin-h) shapes[j].y = shWin-h;
-                        } else {
-                            float r=shapes[j].radius;
-                            if (shapes[j].x < r) shapes[j].x = r;
-                            if (shapes[j].y < r) shapes[j].y = r;
-                            if (shapes[j].x > swWin-r) shapes[j].x = swWin-r;
-                            if (shapes[j].y > shWin-r) shapes[j].y = shWin-r;
-                        }
-                    }
-                }
-            }
-        }
+        ShapesPushApart(shapes, shapeSap, activeIdxPush, (float)swWin, (float)shWin);
 #endif
 
         // ---------- Simulation (balls) ----------
-        for (int i=0;i<NUM_BALLS;++i){
-            Ball *b = &balls[i];
-
-            float spd = hypotf(b->vx, b->vy);
-            int steps = (spd > 0.0f) ? 1 + (int)((spd * dt) / fmaxf(b->r*2.0f, 2.0f)) : 1;
-            if (steps > MAX_SUBSTEPS) steps = MAX_SUBSTEPS; if (steps < 1) steps = 1;
-            float sdt = dt / (float)steps;
-
-            for (int s=0;s<steps;++s){
-                b->x += b->vx * sdt;
-                b->y += b->vy * sdt;
-
-                if (b->x - b->r < 0.0f){ b->x = b->r;       b->vx = -b->vx; }
-                if (b->x + b->r > swWin){ b->x = swWin-b->r; b->vx = -b->vx; }
-                if (b->y - b->r < 0.0f){ b->y = b->r;       b->vy = -b->vy; }
-                if (b->y + b->r > shWin){ b->y = shWin-b->r; b->vy = -b->vy; }
-
-                for (int k=0;k<NUM_SHAPES;++k){
-                    float dx = b->x - shapes[k].x, dy = b->y - shapes[k].y;
-                    float reach = ShapeHullRadius(&shapes[k]) + b->r;
-                    if (dx*dx + dy*dy <= reach*reach){
-                        ResolveCircleVsShape(&shapes[k], b->r, &b->x, &b->y, &b->vx, &b->vy);
-                    }
-                }
-            }
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        double simT0 = GetTime();
+#endif
+        // Shapes are final for this frame: compile them once for every query below
+        ShapeTableBuild(shapeTab, shapes, nShapes);
+#if KINEMATIC_SHAPES
+        shapeAge += DETERMINISTIC ? 1.0f / (float)SIM_HZ : dt;
+        ShapeTableSetMotion(shapeTab, shapePrev, shapeAge);
+#endif
+        ShapeGridBuildHit(&hitGrid, shapes, nShapes, swWin, shWin, HIT_CELL_PX, HIT_PAD);
+        if (FREE_SPACE_SPAWN) SpawnMapUpdate(&spawnMap, shapeTab, swWin, shWin);
+#if BALL_SLEEP
+        if (swWin != sleepSw || shWin != sleepSh){ balls.awake = balls.count; sleepSw = swWin; sleepSh = shWin; }
+        BallsWakeNearMovedShapes(&balls, shapePrev, shapeTab);
+#endif
 
-            int insideAny = 0;
-            for (int k=0;k<NUM_SHAPES && !insideAny;++k){
-                if (PointInShape(b->x, b->y, &shapes[k])) insideAny = 1;
+#if DETERMINISTIC
+        // Exactly one step per frame, whatever the wall clock did
+        const float simDt    = 1.0f / (float)SIM_HZ;
+        const int   simSteps = 1;
+        const float simAlpha = 1.0f;
+        (void)dt;
+#elif FIXED_TIMESTEP
+        // Accumulator: the sim only ever advances by simDt. A hitch is caught up
+        // with at most MAX_CATCHUP_STEPS steps; anything beyond that is dropped.
+        const float simDt = 1.0f / (float)SIM_HZ;
+        int simSteps = 0;
+        simAccum += dt;
+        while (simAccum >= simDt && simSteps < MAX_CATCHUP_STEPS){ simAccum -= simDt; ++simSteps; }
+        if (simAccum >= simDt) simAccum = fmodf(simAccum, simDt);
+        const float simAlpha = simAccum / simDt;
+#else
+        const float simDt    = dt;
+        const int   simSteps = 1;
+        const float simAlpha = 1.0f;
+#endif
+        for (int step=0; step<simSteps; ++step){
+#if COMPACT_BALLS
+          // The body below sees one chunk of the packed store at a time
+          for (int chunk=0; chunk<packed.count; chunk+=balls.cap){
+            BallsUnpack(&packed, chunk, (packed.count - chunk < balls.cap) ? packed.count - chunk : balls.cap, &balls);
+#endif
+            SimFrame frame = { &balls, ballSteps, ballSdt, ballReach, shapeTab, NULL, simDt, (float)swWin, (float)shWin, slices,
+                               { 0 }, (step == 0) };   // grid: set by SimStep; bucketEnd: filled by BallsSortBySteps when it runs
+            const int nSlices = SimStep(&frame, &grid, spawnUse);
+            (void)nSlices;   // only read by the stats below
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            for (int si=0; si<nSlices; ++si){
+                statContactSteps += slices[si].nContact;
+                statTunnel       += slices[si].nTunnel;
+                statTrapped      += slices[si].nTrapped;
+                statRespawned    += slices[si].nRespawn;
+#if KINEMATIC_SHAPES
+                statPlowed       += slices[si].nPlowed;
+#endif
+#if SUBSTEP_BUCKETS
+                for (int j=0;j<STEP_BUCKETS;++j){ statBucketMs[j] += slices[si].bucketMs[j]; slices[si].bucketMs[j] = 0.0; }
+#endif
             }
-            if (insideAny){
-                RespawnBallOutsideAllShapes(b, shapes, NUM_SHAPES, swWin*0.5f, shWin*0.5f);
-            } else {
-                b->trappedFrames = 0;
+#if SUBSTEP_BUCKETS
+            for (int j=0;j<STEP_BUCKETS;++j)
+                statBucketBalls[j] += frame.bucketEnd[j] - ((j + 1 < STEP_BUCKETS) ? frame.bucketEnd[j + 1] : 0);
+#endif
+#endif
+
+#if BALL_BALL_COLLIDE
+            {
+                double bbT0 = GetTime();
+#if SHOW_STATS
+                bbStats.keBefore = BallsKineticEnergy(&balls, balls.count);
+#endif
+                bbStats.contacts = CollideBallsPairwise(&ballHash, &balls, balls.count);
+                bbStats.ms = (GetTime() - bbT0) * 1000.0;
+#if SHOW_STATS
+                bbStats.keAfter = BallsKineticEnergy(&balls, balls.count);
+#endif
             }
+#endif
+#if BALL_SLEEP
+            BallsUpdateSleep(&balls);
+#endif
+#if DETERMINISTIC
+            simHash = SimStateHash(&balls, shapes, nShapes);
+            if (++simStepN % HASH_LOG_STEPS == 0)
+                TraceLog(LOG_INFO, "HASH step %lld: %016llx", simStepN, (unsigned long long)simHash);
+#endif
+#if COMPACT_BALLS
+            BallsPack(&packed, chunk, &balls, (float)swWin, (float)shWin);
+          }
+          packed.sw = (float)swWin; packed.sh = (float)shWin;
+#endif
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            ++statSteps;
+#endif
+        }
+        // Motion is measured from the pose the balls last saw
+        if (simSteps > 0){
+            ShapeTableCopy(shapePrev, shapeTab);
+#if KINEMATIC_SHAPES
+            shapeAge = 0.0f;
+#endif
+        }
+
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        statSimMs = (GetTime() - simT0) * 1000.0;
+        statSimMsSum += statSimMs;
+        if (statSimMs > statSimMsMax) statSimMsMax = statSimMs;
+        ++statFrames;
+#endif
+#if SIM_BENCH_FRAMES
+        if (statFrames >= SIM_BENCH_FRAMES){
+            TraceLog(LOG_INFO, "BENCH: %d balls, %d shapes, %d threads, %d frames: sim %.3f ms/frame, worst %.3f ms",
+                     AppBallCount(), nShapes, SimPoolThreads(), statFrames, statSimMsSum / statFrames, statSimMsMax);
+#if COMPACT_BALLS
+            const double ballBytes = (double)sizeof(BallPacked);
+            const double heapMB    = (ballBytes * packed.cap + (7.0*sizeof(float) + sizeof(Color) + 12.0) * balls.cap) / 1048576.0;
+#else
+            TraceLog(LOG_INFO, "BENCH: %d awake, %d asleep", balls.awake, balls.count - balls.awake);
+            const double ballBytes = 7.0*sizeof(float) + sizeof(Color);
+            const double heapMB    = ((ballBytes + 12.0) * balls.cap) / 1048576.0;   // + steps/sdt/reach scratch
+#endif
+            // Traffic counts each ball record read and written once per sim step,
+            // the floor every format pays; the float kernels touch more.
+            TraceLog(LOG_INFO, "BENCH: %s balls, %.0f B/ball, %.1f MB ball heap, %.2f GB/s ball records, %.1f FPS",
+                     COMPACT_BALLS ? "compact" : "float", ballBytes, heapMB,
+                     2.0 * ballBytes * AppBallCount() * statSteps / (statSimMsSum * 1e6 + 1e-9),
+                     statFrames / (GetTime() - statWallT0));
+            TraceLog(LOG_INFO, "BENCH: balls drawn with %s, %.3f ms/frame CPU submit",
+                     BallPathName(ballRenderer.path),
+                     statBallDrawMs / (statFrames > 1 ? statFrames - 1 : 1));   // this frame is not drawn
+            if (ballRenderer.path == BALL_PATH_CIRCLES)
+                TraceLog(LOG_INFO, "BENCH: pixel balls %s: %.0f per frame, %.0f vertices, %.3f ms/frame",
+                         TINY_BALL_BATCH ? "batched" : "via DrawPixelV",
+                         (double)statTinyBalls / (statFrames > 1 ? statFrames - 1 : 1),
+                         (TINY_BALL_BATCH ? 3.0 : 4.0) * statTinyBalls / (statFrames > 1 ? statFrames - 1 : 1),
+                         statTinyMs / (statFrames > 1 ? statFrames - 1 : 1));
+#if DETERMINISTIC
+            TraceLog(LOG_INFO, "BENCH: seed %llu, %lld steps, state hash %016llx",
+                     (unsigned long long)SIM_SEED, simStepN, (unsigned long long)simHash);
+#endif
+            TraceLog(LOG_INFO, "BENCH: %s, %lld contact-ball steps: tunnel %.3f%%, trapped %.3f%% (%lld trapped, %lld respawned)",
+                     SWEPT_CCD ? "swept CCD" : "substeps", statContactSteps,
+                     100.0 * statTunnel / (statContactSteps ? statContactSteps : 1),
+                     100.0 * statTrapped / (statContactSteps ? statContactSteps : 1), statTrapped, statRespawned);
+#if KINEMATIC_SHAPES
+            TraceLog(LOG_INFO, "BENCH: %lld balls plowed by moving shapes", statPlowed);
+#endif
+#if SUBSTEP_BUCKETS
+            // Time per bucket is the substeps that only exist because of it:
+            // step 0 for 1, step 1 for 2, steps 2-3 for 4, steps 4-7 for 8.
+            // With SWEPT_CCD each bucket also carries its contact balls' sweeps.
+            const double perStep = 1.0 / (double)(statSteps ? statSteps : 1);
+            TraceLog(LOG_INFO, "BENCH: substep buckets 1/2/4/8: %.0f/%.0f/%.0f/%.0f balls per step, %.3f/%.3f/%.3f/%.3f ms per frame",
+                     statBucketBalls[0] * perStep, statBucketBalls[1] * perStep,
+                     statBucketBalls[2] * perStep, statBucketBalls[3] * perStep,
+                     statBucketMs[0] / statFrames, statBucketMs[1] / statFrames,
+                     statBucketMs[2] / statFrames, statBucketMs[3] / statFrames);
+#endif
+#if BALL_BALL_COLLIDE
+            TraceLog(LOG_INFO, "BENCH: ball-ball %d contacts last frame, %.0f contacts/ms",
+                     bbStats.contacts, (bbStats.ms > 0.0) ? bbStats.contacts / bbStats.ms : 0.0);
+#endif
+            break;
         }
+#endif
 
         // ---------- Draw ----------
         BeginDrawing();
@@ -1002,20 +1001,80 @@ int main(void){
             else if (dragTouchShape   != -1) activeIdx = dragTouchShape;
             else if (dragMouseShape   != -1) activeIdx = dragMouseShape;
 
-            for (int i = 0; i < NUM_SHAPES; ++i){
+            for (int i = 0; i < nShapes; ++i){
                 if (i == activeIdx) continue;
                 DrawShapeWithTexture(&shapes[i]);
             }
             if (activeIdx != -1) DrawShapeWithTexture(&shapes[activeIdx]);
 
-            for (int i=0;i<NUM_BALLS;++i){
-                if (balls[i].r <= 1.5f) DrawPixelV(V2(balls[i].x, balls[i].y), balls[i].col);
-                else                     DrawCircleV(V2(balls[i].x, balls[i].y), balls[i].r, balls[i].col);
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            double ballDrawT0 = GetTime();
+#endif
+            BallInstance *inst = BallRendererBegin(&ballRenderer, AppBallCount());
+#if COMPACT_BALLS
+            // No previous position is kept: step back along the velocity instead
+            {
+                const float sx = packed.sw / 65535.0f, sy = packed.sh / 65535.0f;
+                const float back = (simAlpha - 1.0f) * simDt;
+                for (int i=0;i<packed.count;++i){
+                    const BallPacked *q = &packed.b[i];
+                    Vector2 p = V2((float)q->x * sx + FloatFromHalf(q->vx) * back,
+                                   (float)q->y * sy + FloatFromHalf(q->vy) * back);
+                    EmitBall(&ballRenderer, inst, i, p, gBallRadiusLut[q->r], gBallPaletteLut[q->col]);
+                }
             }
+#else
+            // Blend the last two sim states so motion is smooth at any display rate
+            for (int i=0;i<balls.count;++i){
+                Vector2 p = V2(balls.px[i] + (balls.x[i] - balls.px[i]) * simAlpha,
+                               balls.py[i] + (balls.y[i] - balls.py[i]) * simAlpha);
+                EmitBall(&ballRenderer, inst, i, p, balls.r[i], balls.col[i]);
+            }
+#endif
+            if (inst) BallRendererDraw(&ballRenderer, AppBallCount());
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            rlDrawRenderBatchActive();
+            double tinyT0 = GetTime();
+            statTinyBalls += ballRenderer.nTiny;
+#endif
+            BallRendererFlushTiny(&ballRenderer);
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            rlDrawRenderBatchActive();
+            statTinyMs += (GetTime() - tinyT0) * 1000.0;
+#endif
+#if SHOW_STATS || SIM_BENCH_FRAMES
+            rlDrawRenderBatchActive();   // the DrawCircleV path's last batch counts too
+            statBallDrawMs += (GetTime() - ballDrawT0) * 1000.0;
+#endif
 
             // Bottom-right audio controls
             DrawAudioGUI();
 
+#if SHOW_STATS
+            DrawRectangle(8, 8, 260, 84, (Color){0,0,0,140});
+            DrawText(TextFormat("FPS %d   balls %d   shapes %d   thr %d", GetFPS(), AppBallCount(), nShapes, SimPoolThreads()), 14, 14, 10, RAYWHITE);
+            DrawText(TextFormat("sim %.2f ms (%d steps)   avg %.2f ms", statSimMs, simSteps, statSimMsSum / (statFrames ? statFrames : 1)), 14, 32, 10, RAYWHITE);
+            DrawText(TextFormat("%s   tunnel %.3f%%   trapped %.3f%%", SWEPT_CCD ? "CCD" : "substeps",
+                                100.0 * statTunnel / (statContactSteps ? statContactSteps : 1),
+                                100.0 * statTrapped / (statContactSteps ? statContactSteps : 1)), 14, 50, 10, RAYWHITE);
+#if DETERMINISTIC
+            DrawText(TextFormat("awake %d   asleep %d   hash %016llx", balls.awake, balls.count - balls.awake,
+                                (unsigned long long)simHash), 14, 68, 10, RAYWHITE);
+#elif COMPACT_BALLS
+            DrawText(TextFormat("compact %d B/ball   %d chunk(s)", (int)sizeof(BallPacked),
+                                (packed.count + balls.cap - 1) / balls.cap), 14, 68, 10, RAYWHITE);
+#else
+            DrawText(TextFormat("awake %d   asleep %d", balls.awake, balls.count - balls.awake), 14, 68, 10, RAYWHITE);
+#endif
+#if BALL_BALL_COLLIDE
+            DrawRectangle(8, 92, 260, 20, (Color){0,0,0,140});
+            DrawText(TextFormat("ball-ball %d (%.0f/ms)  dE %+.1e", bbStats.contacts,
+                                (bbStats.ms > 0.0) ? bbStats.contacts / bbStats.ms : 0.0,
+                                (bbStats.keBefore > 0.0f) ? (bbStats.keAfter - bbStats.keBefore) / bbStats.keBefore : 0.0f),
+                     14, 96, 10, RAYWHITE);
+#endif
+#endif
+
         EndDrawing();
 
         // ---------- Music stream pump ----------
@@ -1029,7 +1088,25 @@ int main(void){
     }
     if (gAudioReady){ UnloadSound(gTapIn); UnloadSound(gTapOut); CloseAudioDevice(); }
     UnloadTextureBank();
-    free(balls);
+    ShapeGridFree(&grid);
+    ShapeGridFree(&hitGrid);
+#if BALL_BALL_COLLIDE
+    BallHashFree(&ballHash);
+#endif
+    BallStoreFree(&balls);
+#if COMPACT_BALLS
+    BallPackedFree(&packed);
+#endif
+    BallRendererFree(&ballRenderer);
+    SimPoolStop();
+    for (int si=0; si<SIM_THREADS; ++si) SimSliceFree(&slices[si]);
+    free(ballSteps); free(ballSdt); free(ballReach);
+    ShapeTableFree(shapeTab); ShapeTableFree(shapePrev); ShapeSapFree(shapeSap);
+    free(shapeTab); free(shapePrev); free(shapeSap);
+    ShapePoolFree(&shapePool);
+    free(gOps.add); free(gOps.remove);
+    gOps = (AppOps){ .ballCount = -1 };
+    SpawnMapFree(&spawnMap);
     CloseWindow();
     return 0;
 }
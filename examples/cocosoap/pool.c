@@ -0,0 +1,81 @@
+// pool.c — persistent worker pool for the ball sim
+#include "pool.h"
+
+#if SIM_THREADS > 1
+#include <pthread.h>
+
+// Persistent pool: workers sleep on `wake` and run slice `id` of the posted job
+// whenever `gen` moves; the calling thread runs slice 0 and waits on `done`.
+typedef struct {
+    pthread_t       th[SIM_THREADS - 1];
+    pthread_mutex_t mu;
+    pthread_cond_t  wake, done;
+    SimJob          job;
+    void           *ctx;
+    int             workers, nSlices, gen, pending, quit;
+} SimPool;
+static SimPool gPool = { .mu = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER };
+
+static void *SimWorkerMain(void *arg){
+    const int id = (int)(intptr_t)arg;
+    int seen = 0;
+    pthread_mutex_lock(&gPool.mu);
+    for (;;){
+        while (gPool.gen == seen && !gPool.quit) pthread_cond_wait(&gPool.wake, &gPool.mu);
+        if (gPool.quit) break;
+        seen = gPool.gen;
+        if (id >= gPool.nSlices) continue;
+        SimJob job = gPool.job; void *ctx = gPool.ctx;
+        pthread_mutex_unlock(&gPool.mu);
+        job(ctx, id);
+        pthread_mutex_lock(&gPool.mu);
+        if (--gPool.pending == 0) pthread_cond_signal(&gPool.done);
+    }
+    pthread_mutex_unlock(&gPool.mu);
+    return NULL;
+}
+
+void SimPoolStart(void){
+    for (int t=0; t<SIM_THREADS-1; ++t){
+        if (pthread_create(&gPool.th[t], NULL, SimWorkerMain, (void*)(intptr_t)(t + 1)) != 0) break;
+        ++gPool.workers;
+    }
+    TraceLog(LOG_INFO, "SIM: %d worker thread(s)", gPool.workers);
+}
+
+void SimPoolStop(void){
+    pthread_mutex_lock(&gPool.mu);
+    gPool.quit = 1;
+    pthread_cond_broadcast(&gPool.wake);
+    pthread_mutex_unlock(&gPool.mu);
+    for (int t=0; t<gPool.workers; ++t) pthread_join(gPool.th[t], NULL);
+    gPool.workers = 0;
+}
+
+int SimPoolThreads(void){ return gPool.workers + 1; }
+#else
+void SimPoolStart(void){}
+void SimPoolStop(void){}
+int  SimPoolThreads(void){ return 1; }
+#endif
+// Runs job on every slice and returns when all are done.
+void SimRun(SimJob job, void *ctx, int nSlices){
+#if SIM_THREADS > 1
+    if (nSlices > 1){
+        pthread_mutex_lock(&gPool.mu);
+        gPool.job = job; gPool.ctx = ctx; gPool.nSlices = nSlices;
+        gPool.pending = nSlices - 1;
+        ++gPool.gen;
+        pthread_cond_broadcast(&gPool.wake);
+        pthread_mutex_unlock(&gPool.mu);
+
+        job(ctx, 0);
+
+        pthread_mutex_lock(&gPool.mu);
+        while (gPool.pending > 0) pthread_cond_wait(&gPool.done, &gPool.mu);
+        pthread_mutex_unlock(&gPool.mu);
+        return;
+    }
+#endif
+    for (int si=0; si<nSlices; ++si) job(ctx, si);
+}
@@ -0,0 +1,14 @@
+// pool.h — persistent worker pool: runs one job over a set of slices, the calling thread included
+#ifndef POOL_H
+#define POOL_H
+#include "cocosoap.h"
+
+// Runs slice `slice` of whatever ctx describes; slices may not write to shared state.
+typedef void (*SimJob)(void *ctx, int slice);
+
+void SimPoolStart(void);
+void SimPoolStop(void);
+int  SimPoolThreads(void);
+void SimRun(SimJob job, void *ctx, int nSlices);
+
+#endif
@@ -0,0 +1,635 @@
+// render.c — texture bank and atlas, adaptive circles, shape drawing, ball renderer
+#include "render.h"
+
+// ----- Texture bank -----
+// With TEX_ATLAS, gTextures[i] only describes image i (full-size width and
+// height, so shape scale and silhouette math don't change); its pixels are
+// the gTexSrc[i] rectangle of gTexAtlas. Draw with TextureSheet() + gTexSrc.
+static Rectangle gTexSrc[TEX_COUNT]   = {0};
+static Texture2D gTexAtlas = {0};
+static int gTexLoaded = 0;
+
+static const char* TEX_PATHS[TEX_COUNT] = {
+    "assets/characters/comp/1.png",
+    "assets/characters/comp/2.png",
+    "assets/characters/comp/3.png",
+    "assets/characters/comp/4.png",
+    "assets/characters/comp/5.png",
+};
+
+static inline Texture2D TextureSheet(int idx){ return gTexAtlas.id ? gTexAtlas : gTextures[idx]; }
+
+#if TEX_ATLAS
+// Skyline bottom-left packer: the top edge of everything placed so far is
+// kept as a list of horizontal segments, and each rect (tallest first) goes
+// where its top ends lowest. O(rects * segments), so hundreds of images pack
+// in well under a millisecond; sizes include the padding.
+typedef struct { int x, y, w; } SkySeg;
+typedef struct { int idx, h; } PackKey;
+
+static int PackCmpTaller(const void *a, const void *b){
+    const PackKey *ka = (const PackKey*)a, *kb = (const PackKey*)b;
+    return (kb->h != ka->h) ? kb->h - ka->h : ka->idx - kb->idx;
+}
+
+int SkylinePack(const int *w, const int *h, int n, int W, int H, int *ox, int *oy){
+    SkySeg  *sky   = (SkySeg*)malloc(sizeof(SkySeg) * (n + 1));
+    PackKey *order = (PackKey*)malloc(sizeof(PackKey) * n);
+    if (!sky || !order){ free(sky); free(order); return 0; }
+    for (int i=0;i<n;++i) order[i] = (PackKey){ i, h[i] };
+    qsort(order, n, sizeof(PackKey), PackCmpTaller);
+    int ns = 1, ok = 1;
+    sky[0] = (SkySeg){ 0, 0, W };
+    for (int o=0; o<n && ok; ++o){
+        const int i = order[o].idx;
+        if (w[i] <= 0 || h[i] <= 0){ ox[i] = oy[i] = 0; continue; }   // missing image
+        int best = -1, bestTop = H + 1, bestX = 0, bestY = 0;
+        for (int s=0;s<ns;++s){
+            const int x = sky[s].x;
+            if (x + w[i] > W) break;
+            int y = 0;
+            for (int t=s, left=w[i]; left > 0; ++t){   // resting height across the segments it spans
+                if (sky[t].y > y) y = sky[t].y;
+                left -= sky[t].w;
+            }
+            if (y + h[i] <= H && y + h[i] < bestTop){ best = s; bestTop = y + h[i]; bestX = x; bestY = y; }
+        }
+        if (best < 0){ ok = 0; break; }
+        ox[i] = bestX; oy[i] = bestY;
+
+        // New segment over [x, x+w); trim or drop the ones it covers
+        memmove(&sky[best+1], &sky[best], sizeof(SkySeg) * (ns - best));
+        sky[best] = (SkySeg){ bestX, bestTop, w[i] };
+        ++ns;
+        const int right = bestX + w[i];
+        for (int t=best+1; t<ns; ){
+            if (sky[t].x >= right) break;
+            const int cut = right - sky[t].x;
+            if (cut < sky[t].w){ sky[t].x += cut; sky[t].w -= cut; break; }
+            memmove(&sky[t], &sky[t+1], sizeof(SkySeg) * (ns - t - 1));
+            --ns;
+        }
+        for (int t=0; t+1<ns; ){   // merge equal neighbours so the list stays short
+            if (sky[t].y == sky[t+1].y){
+                sky[t].w += sky[t+1].w;
+                memmove(&sky[t+1], &sky[t+2], sizeof(SkySeg) * (ns - t - 2));
+                --ns;
+            } else ++t;
+        }
+    }
+    free(sky); free(order);
+    return ok;
+}
+
+// Copies src into dst at (x+pad, y+pad) and repeats its edge pixels out
+// through the pad, so bilinear taps at a sub-rect's rim see the image's own
+// border rather than a neighbour. Both images are R8G8B8A8.
+static void AtlasBlitPadded(Image *dst, const Image *src, int x, int y, int pad){
+    Color *d = (Color*)dst->data;
+    const Color *s = (const Color*)src->data;
+    for (int j=-pad; j<src->height+pad; ++j){
+        const int sj = (j < 0) ? 0 : (j >= src->height) ? src->height - 1 : j;
+        Color *row = d + (size_t)(y + pad + j) * dst->width + (x + pad);
+        for (int i=-pad; i<src->width+pad; ++i){
+            const int si = (i < 0) ? 0 : (i >= src->width) ? src->width - 1 : i;
+            row[i] = s[(size_t)sj * src->width + si];
+        }
+    }
+}
+
+// imgs[i] (data NULL = missing) become sub-rects of one texture, plus a small
+// white block that raylib's shape functions are pointed at, so untextured
+// shapes and DrawCircleV balls batch with the textured ones. Images are
+// shrunk 0.8x at a time until everything fits TEX_ATLAS_MAX. Returns 0 and
+// leaves gTexAtlas empty if it can't.
+static int TexAtlasBuild(Image *imgs, const int *fullW, const int *fullH){
+    const int WHITE_SIDE = 4;
+    int w[TEX_COUNT + 1], h[TEX_COUNT + 1], ox[TEX_COUNT + 1], oy[TEX_COUNT + 1];
+    int W = 0, H = 0;
+    for (int tries = 0; ; ++tries){
+        long long area = 0;
+        for (int i=0;i<=TEX_COUNT;++i){
+            const int iw = (i == TEX_COUNT) ? WHITE_SIDE : imgs[i].data ? imgs[i].width  : 0;
+            const int ih = (i == TEX_COUNT) ? WHITE_SIDE : imgs[i].data ? imgs[i].height : 0;
+            w[i] = iw ? iw + 2*TEX_ATLAS_PAD : 0;
+            h[i] = ih ? ih + 2*TEX_ATLAS_PAD : 0;
+            area += (long long)w[i] * h[i];
+        }
+        int packed = 0;
+        for (W = 64; W <= TEX_ATLAS_MAX && !packed; W *= 2){   // smallest power-of-two sheet, width first
+            for (H = W / 2; H <= W && !packed; H *= 2){
+                if ((long long)W * H >= area) packed = SkylinePack(w, h, TEX_COUNT + 1, W, H, ox, oy);
+            }
+        }
+        if (packed){ W /= 2; H /= 2; break; }   // undo the loop steps past the hit
+        if (tries == 16) return 0;
+        for (int i=0;i<TEX_COUNT;++i){
+            if (!imgs[i].data) continue;
+            ImageResize(&imgs[i], (imgs[i].width * 4 + 4) / 5, (imgs[i].height * 4 + 4) / 5);
+        }
+    }
+
+    Image sheet = GenImageColor(W, H, BLANK);
+    Image white = GenImageColor(WHITE_SIDE, WHITE_SIDE, WHITE);
+    for (int i=0;i<TEX_COUNT;++i){
+        if (!imgs[i].data) continue;
+        AtlasBlitPadded(&sheet, &imgs[i], ox[i], oy[i], TEX_ATLAS_PAD);
+        gTexSrc[i] = (Rectangle){ (float)(ox[i] + TEX_ATLAS_PAD), (float)(oy[i] + TEX_ATLAS_PAD), (float)imgs[i].width, (float)imgs[i].height };
+    }
+    AtlasBlitPadded(&sheet, &white, ox[TEX_COUNT], oy[TEX_COUNT], TEX_ATLAS_PAD);
+    UnloadImage(white);
+    gTexAtlas = LoadTextureFromImage(sheet);
+    UnloadImage(sheet);
+    if (!TextureOk(gTexAtlas)){ gTexAtlas = (Texture2D){0}; return 0; }
+    SetTextureFilter(gTexAtlas, TEXTURE_FILTER_BILINEAR);
+    for (int i=0;i<TEX_COUNT;++i){
+        if (imgs[i].data) gTextures[i] = (Texture2D){ gTexAtlas.id, fullW[i], fullH[i], 1, gTexAtlas.format };
+    }
+    // Centre of the white block: bilinear taps never leave it
+    SetShapesTexture(gTexAtlas, (Rectangle){ (float)(ox[TEX_COUNT] + TEX_ATLAS_PAD + 1), (float)(oy[TEX_COUNT] + TEX_ATLAS_PAD + 1), 2.0f, 2.0f });
+    TraceLog(LOG_INFO, "ATLAS: texture bank packed into %dx%d", W, H);
+    return 1;
+}
+#endif
+
+void LoadTextureBank(void){
+    if (gTexLoaded) return;
+#if TEXTURE_SDF
+    int nBaked = 0;
+    double bakeMs = 0.0;
+#endif
+#if TEX_ATLAS
+    Image imgs[TEX_COUNT] = {0};
+    int fullW[TEX_COUNT] = {0}, fullH[TEX_COUNT] = {0};
+#endif
+    for (int i=0;i<TEX_COUNT;++i){
+        if (FileExists(TEX_PATHS[i])){
+#if TEXTURE_SDF || TEX_ATLAS
+            // Decode once: the same pixels feed the texture and the silhouette bake.
+            Image img = LoadImage(TEX_PATHS[i]);
+#if TEXTURE_SDF
+            double t0 = GetTime();
+            nBaked += TexSdfBake(&gTexSdf[i], &img);
+            bakeMs += (GetTime() - t0) * 1e3;
+#endif
+#if TEX_ATLAS
+            if (img.data){
+                // Only the atlas-sized copy is kept, so one full-size decode is alive at a time
+                fullW[i] = img.width; fullH[i] = img.height;
+                const int longSide = (img.width > img.height) ? img.width : img.height;
+                if (longSide > TEX_ATLAS_CELL){
+                    ImageResize(&img, (int)((long long)img.width  * TEX_ATLAS_CELL / longSide),
+                                      (int)((long long)img.height * TEX_ATLAS_CELL / longSide));
+                }
+                ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+                imgs[i] = img;
+                gTexSrc[i] = (Rectangle){ 0, 0, (float)img.width, (float)img.height };
+            }
+            continue;
+#else
+            gTextures[i] = LoadTextureFromImage(img);
+            UnloadImage(img);
+#endif
+#else
+            gTextures[i] = LoadTexture(TEX_PATHS[i]);
+#endif
+            if (TextureOk(gTextures[i])) SetTextureFilter(gTextures[i], TEXTURE_FILTER_BILINEAR);
+            gTexSrc[i] = (Rectangle){ 0, 0, (float)gTextures[i].width, (float)gTextures[i].height };
+        }
+    }
+#if TEX_ATLAS
+    if (!TexAtlasBuild(imgs, fullW, fullH)){
+        // No atlas: one texture per image, at the scaled size
+        TraceLog(LOG_WARNING, "ATLAS: texture bank does not fit %d px, using separate textures", TEX_ATLAS_MAX);
+        for (int i=0;i<TEX_COUNT;++i){
+            if (!imgs[i].data) continue;
+            gTextures[i] = LoadTextureFromImage(imgs[i]);
+            gTexSrc[i]   = (Rectangle){ 0, 0, (float)imgs[i].width, (float)imgs[i].height };
+            if (TextureOk(gTextures[i])){
+                SetTextureFilter(gTextures[i], TEXTURE_FILTER_BILINEAR);
+                gTextures[i].width = fullW[i]; gTextures[i].height = fullH[i];   // descriptor keeps the full size
+            }
+        }
+    }
+    for (int i=0;i<TEX_COUNT;++i) if (imgs[i].data) UnloadImage(imgs[i]);
+#endif
+#if TEXTURE_SDF
+    TraceLog(LOG_INFO, "SDF: baked %d silhouettes (%d cells on the long side) in %.2f ms", nBaked, SDF_RES, bakeMs);
+#endif
+    gTexLoaded = 1;
+}
+void UnloadTextureBank(void){
+    if (!gTexLoaded) return;
+    for (int i=0;i<TEX_COUNT;++i){
+        if (TextureOk(gTextures[i]) && gTextures[i].id != gTexAtlas.id) UnloadTexture(gTextures[i]);
+        gTextures[i] = (Texture2D){0};
+        TexSdfFree(&gTexSdf[i]);
+    }
+    if (gTexAtlas.id){
+        SetShapesTexture((Texture2D){ rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 }, (Rectangle){ 0, 0, 1, 1 });
+        UnloadTexture(gTexAtlas);
+        gTexAtlas = (Texture2D){0};
+    }
+    gTexLoaded = 0;
+}
+
+// ----- Adaptive circles -----
+// A circle of radius r cut into n segments misses its rim by r*(1 - cos(pi/n))
+// at each chord's middle. Levels of n are fixed, each with its unit cos/sin
+// table and the largest radius it draws within CIRCLE_CHORD_ERR; a circle
+// takes the first level that covers it. Radii are screen pixels: nothing in
+// this app draws through a camera. Emitted as RL_QUADS of two segments each
+// (centre + three rim points), the way raylib's own circles go out, so they
+// share a batch with the textured quads.
+#define CIRCLE_LODS 12
+static const int CIRCLE_LOD_SEGS[CIRCLE_LODS] = { 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256 };   // even: two per quad
+static float    gCircleLodMaxR[CIRCLE_LODS];
+static Vector2 *gCircleLodRim[CIRCLE_LODS];                  // n+1 unit points, last = first
+static Vector2  gCircleRimPool[6+8+12+16+24+32+48+64+96+128+192+256 + CIRCLE_LODS];
+static int      gCircleLodsReady = 0;
+
+static void CircleLodsInit(void){
+    const double PI_D = 3.14159265358979323846;
+    Vector2 *rim = gCircleRimPool;
+    for (int l=0;l<CIRCLE_LODS;++l){
+        const int n = CIRCLE_LOD_SEGS[l];
+        gCircleLodMaxR[l] = (l == CIRCLE_LODS - 1) ? 1e30f : CIRCLE_CHORD_ERR / (float)(1.0 - cos(PI_D / n));
+        gCircleLodRim[l]  = rim;
+        for (int i=0;i<n;++i) rim[i] = V2((float)cos(2.0*PI_D*i/n), (float)sin(2.0*PI_D*i/n));
+        rim[n] = rim[0];
+        rim += n + 1;
+    }
+    gCircleLodsReady = 1;
+}
+
+void DrawCircleAdaptive(Vector2 c, float r, Color col){
+    if (!gCircleLodsReady) CircleLodsInit();
+    int l = 0;
+    while (gCircleLodMaxR[l] < r) ++l;
+    const int n = CIRCLE_LOD_SEGS[l];
+    const Vector2 *rim = gCircleLodRim[l];
+    const Texture2D tex = GetShapesTexture();
+    const Rectangle rc  = GetShapesTextureRectangle();
+    rlCheckRenderBatchLimit(2*n);   // n/2 quads: the whole circle lands in one batch
+    rlSetTexture(tex.id);
+    rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        rlColor4ub(col.r, col.g, col.b, col.a);
+        rlTexCoord2f((rc.x + rc.width*0.5f) / (float)tex.width, (rc.y + rc.height*0.5f) / (float)tex.height);
+        for (int i=0;i<n;i+=2){   // same corner order as raylib's DrawCircleSector
+            rlVertex2f(c.x, c.y);
+            rlVertex2f(c.x + rim[i+2].x*r, c.y + rim[i+2].y*r);
+            rlVertex2f(c.x + rim[i+1].x*r, c.y + rim[i+1].y*r);
+            rlVertex2f(c.x + rim[i].x*r,   c.y + rim[i].y*r);
+        }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+// ----- Drawing helper -----
+void DrawShapeWithTexture(const Shape *sh){
+    if (sh->type == SHAPE_SQUARE){
+        float sideNow = sh->half * 2.0f;
+        if (TextureIndexOk(sh->texId)){
+            Texture2D tex = gTextures[sh->texId];
+            float sx = (float)tex.width, sy = (float)tex.height;
+            float scale = TextureDrawScale(sh, tex);
+            Rectangle dest = (Rectangle){sh->x, sh->y, sx*scale, sy*scale};
+            Vector2   org  = (Vector2){dest.width*0.5f, dest.height*0.5f};
+            DrawTexturePro(TextureSheet(sh->texId), gTexSrc[sh->texId], dest, org, TextureDrawAngle(sh), sh->tint);
+        } else {
+            DrawRectanglePro((Rectangle){ sh->x, sh->y, sideNow, sideNow },
+                             (Vector2){ sh->half, sh->half }, sh->angle, (Color){230,230,230,255});
+        }
+#if DEBUG_DRAW
+        DrawCircleLines((int)sh->x, (int)sh->y, (int)ShapeHullRadius(sh), (Color){255,0,0,80});
+#endif
+    } else { // circle or polygon
+        if (TextureIndexOk(sh->texId)){
+            Texture2D tex = gTextures[sh->texId];
+            float sx = (float)tex.width, sy = (float)tex.height;
+            float scale    = TextureDrawScale(sh, tex);
+            Rectangle dest = (Rectangle){ sh->x, sh->y, sx*scale, sy*scale };
+            Vector2   org  = (Vector2){ dest.width*0.5f, dest.height*0.5f };
+            DrawTexturePro(TextureSheet(sh->texId), gTexSrc[sh->texId], dest, org, TextureDrawAngle(sh), sh->tint);
+        } else if (sh->type == SHAPE_POLYGON){
+            // Fan around the centre, closed back onto the first vertex
+            const float PI_F = 3.14159265358979323846f;
+            float a = sh->angle*(PI_F/180.0f), c = cosf(a), s = sinf(a);
+            Vector2 fan[POLY_MAX_VERTS + 2];
+            fan[0] = V2(sh->x, sh->y);
+            for (int i=0;i<sh->nVerts;++i){
+                Vector2 w = RotateCS((Vector2){ sh->verts[i].x * sh->radius, sh->verts[i].y * sh->radius }, c, s);
+                fan[i+1] = V2(sh->x + w.x, sh->y + w.y);
+            }
+            fan[sh->nVerts + 1] = fan[1];
+            DrawTriangleFan(fan, sh->nVerts + 2, (Color){235,235,235,255});
+        } else {
+            DrawCircleFilled(V2(sh->x, sh->y), sh->radius, (Color){245,245,245,255});
+        }
+#if DEBUG_DRAW
+        DrawCircleLines((int)sh->x, (int)sh->y, (int)sh->radius, RED);
+#endif
+    }
+}
+
+// ----- Ball renderer -----
+#if defined(PLATFORM_WEB)
+    #define BALL_GLSL_VS "#version 100\n#define IN attribute\n#define OUT varying\n"
+    #define BALL_GLSL_FS "#version 100\nprecision mediump float;\n#define IN varying\n#define FRAG gl_FragColor\n"
+#else
+    #define BALL_GLSL_VS "#version 330\n#define IN in\n#define OUT out\n"
+    #define BALL_GLSL_FS "#version 330\n#define IN in\nout vec4 fragColor;\n#define FRAG fragColor\n"
+#endif
+
+// The quad reaches one pixel past the rim so the edge ramp is never clipped.
+static const char *BALL_VS = BALL_GLSL_VS
+    "IN vec2 corner;\n"
+    "IN vec3 ballXYR;\n"
+    "IN vec4 ballColor;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 proj;\n"
+    "OUT vec2 local;\n"
+    "OUT float radius;\n"
+    "OUT vec4 color;\n"
+    "void main(){\n"
+    "    local  = corner * (ballXYR.z + 1.0);\n"
+    "    radius = ballXYR.z;\n"
+    "    color  = ballColor;\n"
+    "    gl_Position = proj * view * vec4(ballXYR.xy + local, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *BALL_FS = BALL_GLSL_FS
+    "IN vec2 local;\n"
+    "IN float radius;\n"
+    "IN vec4 color;\n"
+    "void main(){\n"
+    "    float d = length(local) - radius;\n"
+    "    float a = clamp(0.5 - d, 0.0, 1.0);\n"
+    "    if (a <= 0.0) discard;\n"
+    "    FRAG = vec4(color.rgb, color.a * a);\n"
+    "}\n";
+
+// rlgl's divisor and instanced-draw calls go straight to GL, unchecked, so
+// the SDF path needs instancing to be there: core from GL 3.3 and ES 3.0,
+// ANGLE_instanced_arrays on WebGL 1.
+static int BallInstancingOk(void){
+    const int v = rlGetVersion();
+    if (v == RL_OPENGL_33 || v == RL_OPENGL_43 || v == RL_OPENGL_ES_30) return 1;
+#ifdef PLATFORM_WEB
+    const EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_get_current_context();
+    return ctx && emscripten_webgl_enable_extension(ctx, "ANGLE_instanced_arrays");
+#else
+    return 0;
+#endif
+}
+
+static int BallShaderInit(BallRenderer *br){
+    if (!BallInstancingOk()){ TraceLog(LOG_INFO, "BALLS: no instanced arrays, SDF path off"); return 0; }
+    br->shader = LoadShaderFromMemory(BALL_VS, BALL_FS);
+    if (!IsShaderValid(br->shader) || br->shader.id == rlGetShaderIdDefault()) return 0;
+    br->locCorner = GetShaderLocationAttrib(br->shader, "corner");
+    br->locXYR    = GetShaderLocationAttrib(br->shader, "ballXYR");
+    br->locColor  = GetShaderLocationAttrib(br->shader, "ballColor");
+    br->locView   = GetShaderLocation(br->shader, "view");
+    br->locProj   = GetShaderLocation(br->shader, "proj");
+    if (br->locCorner < 0 || br->locXYR < 0 || br->locColor < 0){ UnloadShader(br->shader); return 0; }
+    static const float quad[12] = { -1,-1,  -1,1,  1,1,  -1,-1,  1,1,  1,-1 };   // CCW on screen like raylib's quads: rlgl culls back faces
+    br->vao     = rlLoadVertexArray();   // 0 where VAOs are missing: attributes are set per draw anyway
+    br->quadVbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+    if (!br->quadVbo){ UnloadShader(br->shader); return 0; }
+    return 1;
+}
+
+// Buckets grow by BALL_ATLAS_STEP from the smallest radius to BALL_RADIUS_MAX,
+// so a ball's sprite is never scaled down by more than that step. Sprites sit
+// in one row with a 2 px gap, so bilinear sampling never bleeds a neighbour in.
+static int BallAtlasInit(BallRenderer *br){
+    const float r0 = (BALL_RADIUS_MIN > 1.0f) ? BALL_RADIUS_MIN : 1.0f;
+    int n = 0;
+    for (float r = r0; n < BALL_ATLAS_BUCKETS; r *= BALL_ATLAS_STEP){
+        if (r >= BALL_RADIUS_MAX || n == BALL_ATLAS_BUCKETS - 1){ br->atlasR[n++] = BALL_RADIUS_MAX; break; }
+        br->atlasR[n++] = r;
+    }
+    int w = 2, h = 0;
+    for (int k=0;k<n;++k){
+        int side = 2 * (int)ceilf(br->atlasR[k]) + 2;
+        br->atlasSrc[k] = (Rectangle){ (float)w, 2.0f, (float)side, (float)side };
+        w += side + 2;
+        if (side + 4 > h) h = side + 4;
+    }
+    Image img = GenImageColor(w, h, BLANK);
+    Color *px = (Color*)img.data;
+    for (int k=0;k<n;++k){
+        const Rectangle rc = br->atlasSrc[k];
+        const float c = rc.width * 0.5f;
+        for (int y=0; y<(int)rc.height; ++y){
+            for (int x=0; x<(int)rc.width; ++x){
+                float dx = (float)x + 0.5f - c, dy = (float)y + 0.5f - c;
+                float a = 0.5f - (sqrtf(dx*dx + dy*dy) - br->atlasR[k]);
+                a = (a < 0.0f) ? 0.0f : (a > 1.0f) ? 1.0f : a;
+                px[((int)rc.y + y) * w + (int)rc.x + x] = (Color){ 255, 255, 255, (unsigned char)(a * 255.0f + 0.5f) };
+            }
+        }
+    }
+    br->atlas = LoadTextureFromImage(img);
+    UnloadImage(img);
+    if (!TextureOk(br->atlas)){ br->atlas = (Texture2D){0}; return 0; }
+    SetTextureFilter(br->atlas, TEXTURE_FILTER_BILINEAR);
+
+    br->nBuckets  = n;
+    br->nBucketOf = (int)ceilf(BALL_RADIUS_MAX * 4.0f) + 1;
+    br->bucketOf  = (unsigned char*)malloc((size_t)br->nBucketOf);
+    if (!br->bucketOf){ UnloadTexture(br->atlas); br->atlas = (Texture2D){0}; return 0; }
+    for (int q=0, k=0; q<br->nBucketOf; ++q){
+        while (k < n - 1 && br->atlasR[k] < (float)q * 0.25f) ++k;
+        br->bucketOf[q] = (unsigned char)k;
+    }
+    return 1;
+}
+
+const char *BallPathName(BallPath p){
+    return (p == BALL_PATH_SDF) ? "instanced SDF quads" : (p == BALL_PATH_ATLAS) ? "sprite atlas quads"
+         : ADAPTIVE_CIRCLES ? "adaptive circle fans" : "DrawCircleV";
+}
+
+void BallRendererInit(BallRenderer *br){
+    *br = (BallRenderer){0};
+    br->sdfOk = BALL_SDF_RENDER && BallShaderInit(br);
+    int atlasOk = BALL_SPRITE_ATLAS && BallAtlasInit(br);
+    br->path = br->sdfOk ? BALL_PATH_SDF : atlasOk ? BALL_PATH_ATLAS : BALL_PATH_CIRCLES;
+    TraceLog(LOG_INFO, "BALLS: drawn as %s%s", BallPathName(br->path),
+             atlasOk ? TextFormat(" (%d-sprite atlas, %dx%d)", br->nBuckets, br->atlas.width, br->atlas.height) : "");
+}
+
+void BallRendererFree(BallRenderer *br){
+    if (br->sdfOk){
+        rlUnloadVertexBuffer(br->quadVbo);
+        if (br->instVbo) rlUnloadVertexBuffer(br->instVbo);
+        if (br->vao) rlUnloadVertexArray(br->vao);
+        UnloadShader(br->shader);
+    }
+    if (br->atlas.id) UnloadTexture(br->atlas);
+    free(br->bucketOf); free(br->inst); free(br->tiny);
+    *br = (BallRenderer){0};
+}
+
+// Staging for n records, or NULL (draw with DrawCircleFilled instead).
+BallInstance *BallRendererBegin(BallRenderer *br, int n){
+    br->nTiny = 0;
+    if (n > br->tinyCap){
+        TinyBall *tiny = (TinyBall*)realloc(br->tiny, sizeof(TinyBall) * n);
+        if (tiny){ br->tiny = tiny; br->tinyCap = n; }
+    }
+    if (br->path == BALL_PATH_CIRCLES) return NULL;
+    if (n > br->cap){
+        int cap = (br->cap * 2 > n) ? br->cap * 2 : n;
+        BallInstance *inst = (BallInstance*)realloc(br->inst, sizeof(BallInstance) * cap);
+        if (!inst) return NULL;
+        br->inst = inst; br->cap = cap;
+    }
+    if (br->path == BALL_PATH_SDF && n > br->vboCap){
+        if (br->instVbo) rlUnloadVertexBuffer(br->instVbo);
+        br->instVbo = rlLoadVertexBuffer(NULL, (int)sizeof(BallInstance) * br->cap, true);
+        br->vboCap  = br->instVbo ? br->cap : 0;
+        if (!br->instVbo) return NULL;
+    }
+    return br->inst;
+}
+
+// texcoord are set once, then a colour and three corners per ball. Each
+// triangle is snapped to the pixel DrawPixelV's quad would fill and is
+// 1.5 px on the legs, so it covers that pixel's centre and no other: same
+// pixels as the quad, one vertex fewer. DrawPixelV pays a texture switch,
+// rlBegin/rlEnd and the full vertex state per ball; with TINY_BALL_BATCH off
+// it is used here instead, for comparison. Each ball checks the batch has
+// room for its triangle first; a flush keeps the mode, texture and texcoord.
+void BallRendererFlushTiny(BallRenderer *br){
+    if (br->nTiny == 0) return;
+    if (!TINY_BALL_BATCH){
+        for (int i=0;i<br->nTiny;++i) DrawPixelV(V2(br->tiny[i].x, br->tiny[i].y), br->tiny[i].col);
+        return;
+    }
+    const Texture2D tex = GetShapesTexture();
+    const Rectangle rc  = GetShapesTextureRectangle();
+    rlSetTexture(tex.id);
+    rlBegin(RL_TRIANGLES);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        rlTexCoord2f((rc.x + rc.width*0.5f) / (float)tex.width, (rc.y + rc.height*0.5f) / (float)tex.height);
+        for (int i=0;i<br->nTiny;++i){
+            const TinyBall *t = &br->tiny[i];
+            const float x = ceilf(t->x - 0.5f), y = floorf(t->y + 0.5f);   // pixel whose centre DrawPixelV's quad covers, GL's tie rule
+            rlCheckRenderBatchLimit(3);
+            rlColor4ub(t->col.r, t->col.g, t->col.b, t->col.a);
+            rlVertex2f(x,        y);
+            rlVertex2f(x,        y + 1.5f);
+            rlVertex2f(x + 1.5f, y);
+        }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+// Same corner order as DrawTexturePro, tinted by the ball colour. Each quad
+// checks the batch has room first, so a flush never splits one.
+static void BallRendererDrawAtlas(BallRenderer *br, int n){
+    const float iw = 1.0f / (float)br->atlas.width, ih = 1.0f / (float)br->atlas.height;
+    rlSetTexture(br->atlas.id);
+    rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i=0;i<n;++i){
+            const BallInstance *b = &br->inst[i];
+            int q = (int)ceilf(b->r * 4.0f);
+            q = (q < 0) ? 0 : (q >= br->nBucketOf) ? br->nBucketOf - 1 : q;
+            const int k = br->bucketOf[q];
+            const Rectangle rc = br->atlasSrc[k];
+            const float h  = rc.width * 0.5f * (b->r / br->atlasR[k]);
+            const float u0 = rc.x * iw, v0 = rc.y * ih, u1 = (rc.x + rc.width) * iw, v1 = (rc.y + rc.height) * ih;
+            rlCheckRenderBatchLimit(4);
+            rlColor4ub((unsigned char)b->col, (unsigned char)(b->col >> 8), (unsigned char)(b->col >> 16), (unsigned char)(b->col >> 24));
+            rlTexCoord2f(u0, v0); rlVertex2f(b->x - h, b->y - h);
+            rlTexCoord2f(u0, v1); rlVertex2f(b->x - h, b->y + h);
+            rlTexCoord2f(u1, v1); rlVertex2f(b->x + h, b->y + h);
+            rlTexCoord2f(u1, v0); rlVertex2f(b->x + h, b->y - h);
+        }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+// SDF: flushes rlgl's batch first so the balls land on top of what was
+// drawn, then leaves the attribute state as the batch expects it.
+void BallRendererDraw(BallRenderer *br, int n){
+    if (n <= 0) return;
+    if (br->path == BALL_PATH_ATLAS){ BallRendererDrawAtlas(br, n); return; }
+    rlDrawRenderBatchActive();
+    rlUpdateVertexBuffer(br->instVbo, br->inst, (int)sizeof(BallInstance) * n, 0);
+
+    rlEnableShader(br->shader.id);
+    rlSetUniformMatrix(br->locView, rlGetMatrixModelview());
+    rlSetUniformMatrix(br->locProj, rlGetMatrixProjection());
+    rlEnableVertexArray(br->vao);
+    rlEnableVertexBuffer(br->quadVbo);
+    rlSetVertexAttribute(br->locCorner, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(br->locCorner);
+    rlEnableVertexBuffer(br->instVbo);
+    rlSetVertexAttribute(br->locXYR, 3, RL_FLOAT, false, sizeof(BallInstance), 0);
+    rlSetVertexAttribute(br->locColor, 4, RL_UNSIGNED_BYTE, true, sizeof(BallInstance), offsetof(BallInstance, col));
+    rlEnableVertexAttribute(br->locXYR);
+    rlEnableVertexAttribute(br->locColor);
+    rlSetVertexAttributeDivisor(br->locXYR, 1);
+    rlSetVertexAttributeDivisor(br->locColor, 1);
+
+    rlDrawVertexArrayInstanced(0, 6, n);
+
+    rlSetVertexAttributeDivisor(br->locXYR, 0);
+    rlSetVertexAttributeDivisor(br->locColor, 0);
+    rlDisableVertexAttribute(br->locCorner);
+    rlDisableVertexAttribute(br->locXYR);
+    rlDisableVertexAttribute(br->locColor);
+    rlDisableVertexBuffer();
+    rlDisableVertexArray();
+    rlDisableShader();
+}
+
+#if RENDER_BENCH
+// Static random balls, no sim, frame rate unlocked: each path draws the same
+// set for `frames` frames at 3k, 10k and 50k balls. Wall-clock FPS over the
+// whole frame, so swap cost is in it; a driver that forces vsync caps it.
+void BallRendererBench(BallRenderer *br, int frames){
+    static const int counts[3] = { 3000, 10000, 50000 };
+    BallInstance *set = (BallInstance*)malloc(sizeof(BallInstance) * counts[2]);
+    Color *cols = (Color*)malloc(sizeof(Color) * counts[2]);
+    if (!set || !cols){ free(set); free(cols); return; }
+    const float w = (float)GetScreenWidth(), h = (float)GetScreenHeight();
+    for (int i=0;i<counts[2];++i){
+        float r = BALL_RADIUS_MIN + (BALL_RADIUS_MAX - BALL_RADIUS_MIN) * (float)GetRandomValue(0, 1000) / 1000.0f;
+        cols[i] = ColorFromHSV((float)GetRandomValue(0, 359), 0.8f, 0.9f);
+        set[i]  = (BallInstance){ (float)GetRandomValue(0, (int)w), (float)GetRandomValue(0, (int)h), r, PackColor(cols[i]) };
+    }
+    const BallPath keep = br->path;
+    SetTargetFPS(0);
+    for (int c=0;c<3;++c){
+        for (int p=BALL_PATH_CIRCLES; p<=BALL_PATH_SDF; ++p){
+            if (p == BALL_PATH_ATLAS && !br->atlas.id) continue;
+            if (p == BALL_PATH_SDF && !br->sdfOk) continue;
+            br->path = (BallPath)p;
+            const int n = counts[c];
+            double t0 = 0.0;
+            for (int f=0; f<frames + 1; ++f){
+                if (f == 1) t0 = GetTime();   // first frame pays buffer growth
+                BeginDrawing();
+                    ClearBackground(WHITE);
+                    BallInstance *inst = BallRendererBegin(br, n);
+                    for (int i=0;i<n;++i) EmitBall(br, inst, i, V2(set[i].x, set[i].y), set[i].r, cols[i]);
+                    if (inst) BallRendererDraw(br, n);
+                    BallRendererFlushTiny(br);
+                EndDrawing();
+            }
+            const double dt = GetTime() - t0;
+            TraceLog(LOG_INFO, "RENDERBENCH: %6d balls  %-20s %7.1f FPS", n, BallPathName(br->path), (dt > 0.0) ? frames / dt : 0.0);
+        }
+    }
+    br->path = keep;
+    SetTargetFPS(90);   // main()'s cap
+    free(set); free(cols);
+}
+#endif
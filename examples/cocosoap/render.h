@@ -0,0 +1,88 @@
+// render.h — texture bank, shape drawing and the ball renderer
+#ifndef RENDER_H
+#define RENDER_H
+#include "shapes.h"
+#include "rlgl.h"
+
+// ----- Texture bank -----
+void LoadTextureBank(void);
+void UnloadTextureBank(void);
+#if TEX_ATLAS
+int  SkylinePack(const int *w, const int *h, int n, int W, int H, int *ox, int *oy);
+#endif
+
+// ----- Adaptive circles -----
+void DrawCircleAdaptive(Vector2 c, float r, Color col);
+
+static inline void DrawCircleFilled(Vector2 c, float r, Color col){
+    if (ADAPTIVE_CIRCLES) DrawCircleAdaptive(c, r, col);
+    else                  DrawCircleV(c, r, col);
+}
+
+// ----- Drawing helper -----
+void DrawShapeWithTexture(const Shape *sh);
+
+// ----- Ball renderer -----
+// Three paths, best available picked at startup:
+//  - SDF: one 16-byte record per ball in a single dynamic vertex buffer;
+//    every ball is a quad, and the fragment shader cuts an anti-aliased
+//    circle out of it with the signed distance to the rim. One draw call for
+//    all balls, nothing through rlgl's immediate-mode batch. GLSL 100 on web
+//    (ANGLE_instanced_arrays), 330 on desktop.
+//  - Atlas: for targets without custom shaders. Circles pre-rasterized at
+//    radius buckets into one texture; a ball is one tinted quad of its
+//    bucket's sprite, so the batch never switches texture.
+//  - Circles: DrawCircleFilled per ball.
+typedef struct {
+    float    x, y, r;
+    uint32_t col;      // RGBA8, read as normalized bytes
+} BallInstance;
+
+typedef struct { float x, y; Color col; } TinyBall;
+
+typedef enum { BALL_PATH_CIRCLES = 0, BALL_PATH_ATLAS = 1, BALL_PATH_SDF = 2 } BallPath;
+
+#define BALL_ATLAS_BUCKETS 24   // cap on sprite sizes; BALL_ATLAS_STEP spacing needs ~15 for r 1..20
+
+typedef struct {
+    BallPath      path;
+    Shader        shader;
+    unsigned int  vao, quadVbo, instVbo;
+    int           locCorner, locXYR, locColor, locView, locProj;
+    int           sdfOk, vboCap;
+    Texture2D     atlas;                            // id 0 = no atlas
+    Rectangle     atlasSrc[BALL_ATLAS_BUCKETS];     // sprite k: a circle of radius atlasR[k] with a 1 px rim
+    float         atlasR[BALL_ATLAS_BUCKETS];
+    unsigned char *bucketOf;                        // ceil(4r) -> smallest bucket with atlasR >= r
+    int           nBuckets, nBucketOf;
+    int           cap;
+    BallInstance *inst;    // CPU staging for the SDF and atlas paths, refilled every frame
+    TinyBall     *tiny;    // DrawCircleV fallback: balls of r <= 1.5, drawn after the rest in one pixel-triangle run
+    int           nTiny, tinyCap;
+} BallRenderer;
+
+const char   *BallPathName(BallPath p);
+void          BallRendererInit(BallRenderer *br);
+void          BallRendererFree(BallRenderer *br);
+BallInstance *BallRendererBegin(BallRenderer *br, int n);
+void          BallRendererFlushTiny(BallRenderer *br);
+void          BallRendererDraw(BallRenderer *br, int n);
+#if RENDER_BENCH
+void          BallRendererBench(BallRenderer *br, int frames);
+#endif
+
+static inline uint32_t PackColor(Color c){
+    return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);   // byte order = memory order on every target we build
+}
+
+// One ball: into the instance staging when there is one, else straight
+// through raylib's shape functions, with pixel-sized balls set aside for
+// BallRendererFlushTiny.
+static inline void EmitBall(BallRenderer *br, BallInstance *inst, int i, Vector2 p, float r, Color c){
+    if (inst){ inst[i] = (BallInstance){ p.x, p.y, r, PackColor(c) }; return; }
+    if (r > 1.5f) DrawCircleFilled(p, r, c);
+    else if (br->nTiny < br->tinyCap) br->tiny[br->nTiny++] = (TinyBall){ p.x, p.y, c };
+    else DrawPixelV(p, c);
+}
+
+#endif
@@ -0,0 +1,544 @@
+// shapes.c — silhouette SDF bake, shape pool, sweep-and-prune push, compiled shape table, shape grid
+#include "shapes.h"
+
+TexSdf    gTexSdf[TEX_COUNT]   = {0};
+Texture2D gTextures[TEX_COUNT] = {0};
+
+// ----- Texture silhouette SDF -----
+// Lower envelope of the parabolas (q - p)^2 + f[p]: d[q] = min_p of that.
+static void Edt1D(const float *f, float *d, int *v, float *z, int n){
+    int k = 0;
+    v[0] = 0; z[0] = -SDF_FAR; z[1] = SDF_FAR;
+    for (int q=1;q<n;++q){
+        float s;
+        for (;;){
+            int p = v[k];
+            s = ((f[q] + (float)(q*q)) - (f[p] + (float)(p*p))) / (float)(2*(q - p));
+            if (s > z[k]) break;
+            --k;
+        }
+        ++k; v[k] = q; z[k] = s; z[k+1] = SDF_FAR;
+    }
+    k = 0;
+    for (int q=0;q<n;++q){
+        while (z[k+1] < (float)q) ++k;
+        float t = (float)(q - v[k]);
+        d[q] = t*t + f[v[k]];
+    }
+}
+
+// In place over a w*h grid of 0 (seed) / SDF_FAR values.
+static void Edt2D(float *g, int w, int h, float *f, float *d, int *v, float *z){
+    for (int x=0;x<w;++x){
+        for (int y=0;y<h;++y) f[y] = g[y*w + x];
+        Edt1D(f, d, v, z, h);
+        for (int y=0;y<h;++y) g[y*w + x] = d[y];
+    }
+    for (int y=0;y<h;++y){
+        memcpy(f, g + y*w, sizeof(float) * w);
+        Edt1D(f, g + y*w, v, z, w);
+    }
+}
+
+void TexSdfFree(TexSdf *s){
+    free(s->d);
+    *s = (TexSdf){0};
+}
+
+int TexSdfBake(TexSdf *s, Image *img){
+    const int SS = 4;   // alpha samples per cell side
+    TexSdfFree(s);
+    if (!img->data || img->width <= 0 || img->height <= 0) return 0;
+    if (img->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) ImageFormat(img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    const unsigned char *px = (const unsigned char*)img->data;
+    const int W = img->width, H = img->height;
+    const float cellPx = (float)((W > H) ? W : H) / (float)SDF_RES;
+    const int iw = (int)ceilf((float)W / cellPx), ih = (int)ceilf((float)H / cellPx);
+    const int w = iw + 2, h = ih + 2, m = (w > h) ? w : h;
+
+    float *out = (float*)malloc(sizeof(float) * w * h);   // squared distance to solid
+    float *in  = (float*)malloc(sizeof(float) * w * h);   // squared distance to clear
+    float *f   = (float*)malloc(sizeof(float) * m);
+    float *d   = (float*)malloc(sizeof(float) * m);
+    float *z   = (float*)malloc(sizeof(float) * (m + 1));
+    int   *v   = (int*)malloc(sizeof(int) * m);
+    if (!out || !in || !f || !d || !z || !v){ free(out); free(in); free(f); free(d); free(z); free(v); return 0; }
+
+    int nSolid = 0;
+    for (int cy=0; cy<h; ++cy){
+        for (int cx=0; cx<w; ++cx){
+            int solid = 0;
+            if (cx > 0 && cy > 0 && cx <= iw && cy <= ih){
+                int sum = 0;
+                for (int sy=0; sy<SS; ++sy){
+                    int ty = (int)(((float)(cy - 1) + ((float)sy + 0.5f) / SS) * cellPx);
+                    if (ty > H - 1) ty = H - 1;
+                    const unsigned char *row = px + (size_t)ty * W * 4 + 3;
+                    for (int sx=0; sx<SS; ++sx){
+                        int tx = (int)(((float)(cx - 1) + ((float)sx + 0.5f) / SS) * cellPx);
+                        if (tx > W - 1) tx = W - 1;
+                        sum += row[(size_t)tx * 4];
+                    }
+                }
+                solid = (sum >= SDF_ALPHA_CUT * SS * SS);
+            }
+            out[cy*w + cx] = solid ? 0.0f : SDF_FAR;
+            in [cy*w + cx] = solid ? SDF_FAR : 0.0f;
+            nSolid += solid;
+        }
+    }
+    if (nSolid == 0){ free(out); free(in); free(f); free(d); free(z); free(v); return 0; }
+
+    Edt2D(out, w, h, f, d, v, z);
+    Edt2D(in,  w, h, f, d, v, z);
+
+    s->w = w; s->h = h; s->cellPx = cellPx;
+    s->ox = 1.0f + 0.5f * (float)W / cellPx;
+    s->oy = 1.0f + 0.5f * (float)H / cellPx;
+    float reach2 = 0.0f;
+    for (int cy=0; cy<h; ++cy){
+        for (int cx=0; cx<w; ++cx){
+            int i = cy*w + cx;
+            if (out[i] == 0.0f){
+                out[i] = 0.5f - sqrtf(in[i]);   // the edge sits half a cell out from the last solid centre
+                float dx = (float)cx + 0.5f - s->ox, dy = (float)cy + 0.5f - s->oy;
+                if (dx*dx + dy*dy > reach2) reach2 = dx*dx + dy*dy;
+            } else {
+                out[i] = sqrtf(out[i]) - 0.5f;
+            }
+        }
+    }
+    s->reach = sqrtf(reach2) + 0.70710678f;
+    s->d = out;
+    free(in); free(f); free(d); free(z); free(v);
+    return 1;
+}
+
+// ----- Shape pool -----
+// Polygon outline scaled to unit circumradius about (0,0) and wound the way
+// DrawTriangleFan and the edge normals expect. Convexity is the caller's job.
+static void PolygonOutlineFromInit(Shape *sh, const ShapeInit *S){
+    int n = S->nVerts;
+    if (n > POLY_MAX_VERTS) n = POLY_MAX_VERTS;
+    if (!S->verts || n < 3){
+        n = (n >= 3) ? n : POLY_DEFAULT_SIDES;
+        for (int i=0;i<n;++i){
+            float s, c; SimSinCosDeg(-360.0f * (float)i / (float)n, &s, &c);
+            sh->verts[i] = (Vector2){ c, s };
+        }
+    } else {
+        for (int i=0;i<n;++i) sh->verts[i] = S->verts[i];
+    }
+    float area2 = 0.0f, far2 = 0.0f;
+    for (int i=0, j=n-1; i<n; j=i++){
+        area2 += sh->verts[j].x*sh->verts[i].y - sh->verts[i].x*sh->verts[j].y;
+        float d2 = sh->verts[i].x*sh->verts[i].x + sh->verts[i].y*sh->verts[i].y;
+        if (d2 > far2) far2 = d2;
+    }
+    float inv = (far2 > 0.0f) ? 1.0f / sqrtf(far2) : 1.0f;
+    for (int i=0;i<n;++i){ sh->verts[i].x *= inv; sh->verts[i].y *= inv; }
+    if (area2 > 0.0f){
+        for (int i=0, j=n-1; i<j; ++i, --j){ Vector2 t = sh->verts[i]; sh->verts[i] = sh->verts[j]; sh->verts[j] = t; }
+    }
+    sh->nVerts = n;
+}
+
+Shape ShapeFromInit(const ShapeInit *S){
+    Shape sh = {0};
+    sh.type  = S->type;
+    sh.x     = S->x;
+    sh.y     = S->y;
+    sh.angle = S->angle;
+    sh.texId = (S->texId >= 0 && S->texId < TEX_COUNT && TextureOk(gTextures[S->texId])) ? S->texId : -1;
+    sh.fit   = S->fit;
+    sh.tint  = S->tint;
+    if (S->type == SHAPE_SQUARE){
+        float side = (S->size <= 0 ? 160.0f : S->size);
+        if (side < SQUARE_MIN_SIDE) side = SQUARE_MIN_SIDE;
+        if (side > SQUARE_MAX_SIDE) side = SQUARE_MAX_SIDE;
+        sh.half = side * 0.5f;
+    } else {
+        float diam = (S->size <= 0 ? 160.0f : S->size);
+        float r = diam * 0.5f;
+        if (r < CIRCLE_R_MIN) r = CIRCLE_R_MIN;
+        if (r > CIRCLE_R_MAX) r = CIRCLE_R_MAX;
+        sh.radius = r;
+        if (S->type == SHAPE_POLYGON) PolygonOutlineFromInit(&sh, S);
+    }
+    return sh;
+}
+
+// Small square sized so `total` of them cover ~25% of the window.
+ShapeInit ScatteredShapeInit(int sw, int sh, int total){
+    float side = TUNNEL_BENCH ? SQUARE_MIN_SIDE : sqrtf((float)sw * (float)sh * 0.25f / (float)(total > 0 ? total : 1));
+    float x = (float)SimRandInt(0, sw), y = (float)SimRandInt(0, sh), a = (float)SimRandInt(0, 359);
+    return (ShapeInit){ SHAPE_SQUARE, x, y, side, a, -1, TEX_FIT_COVER, WHITE, 0, NULL };
+}
+
+int ShapePoolReserve(ShapePool *p, int cap){
+    if (cap <= p->cap) return 1;
+    Shape *items = (Shape*)realloc(p->items, sizeof(Shape) * cap);
+    if (!items) return 0;
+    p->items = items;
+    int *ho = (int*)realloc(p->handleOf, sizeof(int) * cap);
+    if (!ho) return 0;
+    p->handleOf = ho;
+    p->cap = cap;
+    return 1;
+}
+
+void ShapePoolFree(ShapePool *p){
+    free(p->items); free(p->handleOf); free(p->slotOf); free(p->freeHandles);
+    *p = (ShapePool){0};
+}
+
+// Hands out a handle before the shape is placed (-2 = queued).
+int ShapePoolNewHandle(ShapePool *p){
+    if (p->nFree > 0){ int h = p->freeHandles[--p->nFree]; p->slotOf[h] = -2; return h; }
+    if (p->nHandles == p->handleCap){
+        int cap = p->handleCap ? p->handleCap * 2 : 64;
+        int *so = (int*)realloc(p->slotOf, sizeof(int) * cap);
+        if (!so) return -1;
+        p->slotOf = so;
+        int *fh = (int*)realloc(p->freeHandles, sizeof(int) * cap);
+        if (!fh) return -1;
+        p->freeHandles = fh;
+        p->handleCap = cap;
+    }
+    p->slotOf[p->nHandles] = -2;
+    return p->nHandles++;
+}
+
+// Appends on top of the draw order; returns the dense index or -1.
+int ShapePoolPlace(ShapePool *p, int h, Shape sh){
+    if (h < 0 || h >= p->nHandles || p->slotOf[h] != -2) return -1;
+    if (p->count == p->cap && !ShapePoolReserve(p, p->cap ? p->cap * 2 : 16)) return -1;
+    int i = p->count++;
+    p->items[i] = sh;
+    p->handleOf[i] = h;
+    p->slotOf[h] = i;
+    return i;
+}
+
+// Swap-remove: the last shape moves into the hole, so it also moves down in
+// the draw order. Returns the freed dense index or -1.
+int ShapePoolRemove(ShapePool *p, int h){
+    if (h < 0 || h >= p->nHandles || p->slotOf[h] == -1) return -1;
+    int i = p->slotOf[h];
+    p->slotOf[h] = -1;
+    p->freeHandles[p->nFree++] = h;
+    if (i < 0) return -1;   // was still queued
+    int last = --p->count;
+    p->items[i]    = p->items[last];
+    p->handleOf[i] = p->handleOf[last];
+    p->slotOf[p->handleOf[i]] = i;
+    return i;
+}
+
+// ----- Shape↔shape push (sweep and prune) -----
+int ShapeSapReserve(ShapeSap *sap, int n){
+    if (n <= sap->cap) return 1;
+    int cap = (sap->cap * 2 > n) ? sap->cap * 2 : n;
+    int   *o = (int*)realloc(sap->order, sizeof(int) * cap);
+    if (o) sap->order = o;
+    float *l = (float*)realloc(sap->lo, sizeof(float) * cap);
+    if (l) sap->lo = l;
+    float *h = (float*)realloc(sap->hull, sizeof(float) * cap);
+    if (h) sap->hull = h;
+    if (!o || !l || !h) return 0;
+    sap->cap = cap;
+    return 1;
+}
+
+void ShapeSapFree(ShapeSap *sap){
+    free(sap->order); free(sap->lo); free(sap->hull);
+    *sap = (ShapeSap){0};
+}
+
+// Mirrors ShapePoolAdd: the new shape is the last index, slotted in at the end.
+void ShapeSapAdd(ShapeSap *sap){
+    if (!ShapeSapReserve(sap, sap->n + 1)) return;
+    sap->order[sap->n] = sap->n;
+    ++sap->n;
+}
+
+// Mirrors the pool's swap-remove: drop idx from the order, then rename the
+// last index to idx. The rest of the order is untouched.
+void ShapeSapRemove(ShapeSap *sap, int idx){
+    const int last = sap->n - 1;
+    int w = 0;
+    for (int a=0; a<sap->n; ++a){
+        int k = sap->order[a];
+        if (k == idx) continue;
+        sap->order[w++] = (k == last) ? idx : k;
+    }
+    sap->n = last;
+}
+
+static void ShapeSapSort(ShapeSap *sap, const Shape *shapes){
+    for (int i=0;i<sap->n;++i) sap->lo[i] = shapes[i].x - sap->hull[i];
+    for (int a=1; a<sap->n; ++a){
+        int k = sap->order[a];
+        float key = sap->lo[k];
+        int b = a - 1;
+        while (b >= 0 && sap->lo[sap->order[b]] > key){ sap->order[b+1] = sap->order[b]; --b; }
+        sap->order[b+1] = k;
+    }
+}
+
+// The active (dragged) shape takes a quarter of each push instead of half.
+void ShapesPushApart(Shape *shapes, ShapeSap *sap, int activeIdx, float sw, float sh){
+    for (int i=0;i<sap->n;++i) sap->hull[i] = ShapeHullRadius(&shapes[i]);
+    for (int pass=0; pass<2; ++pass){
+        ShapeSapSort(sap, shapes);
+        for (int a=0; a<sap->n; ++a){
+            const int i = sap->order[a];
+            const float ri = sap->hull[i];
+            for (int b=a+1; b<sap->n; ++b){
+                const int j = sap->order[b];
+                const float rj = sap->hull[j];
+                if (sap->lo[j] > sap->lo[i] + 2.0f*ri) break;
+                float dx = shapes[j].x - shapes[i].x;
+                float dy = shapes[j].y - shapes[i].y;
+                float need = ri + rj + 0.001f;
+                if (fabsf(dy) >= need) continue;
+                float d2 = dx*dx + dy*dy;
+                if (d2 >= need*need) continue;
+
+                float d = (d2>1e-8f)? sqrtf(d2) : 0.0f;
+                float nx = (d>1e-8f)? (dx/d) : 1.0f;
+                float ny = (d>1e-8f)? (dy/d) : 0.0f;
+                float pen = need - d;
+
+                float wi = (i==activeIdx) ? 0.25f : 0.5f;
+                float wj = (j==activeIdx) ? 0.25f : 0.5f;
+                float sum = wi + wj; wi/=sum; wj/=sum;
+
+                shapes[i].x -= nx * pen * wi;
+                shapes[i].y -= ny * pen * wi;
+                shapes[j].x += nx * pen * wj;
+                shapes[j].y += ny * pen * wj;
+                ClampShapeToWindow(&shapes[i], sw, sh);
+                ClampShapeToWindow(&shapes[j], sw, sh);
+            }
+        }
+    }
+}
+
+// ----- Compiled shape table -----
+int ShapeTableReserve(ShapeTable *t, int n){
+    if (n <= t->cap) return 1;
+    int cap = (t->cap * 2 > n) ? t->cap * 2 : n;
+    ShapeCompiled *k = (ShapeCompiled*)realloc(t->k, sizeof(ShapeCompiled) * cap);
+    if (k) t->k = k;
+    int *sq = (int*)realloc(t->squares, sizeof(int) * cap);
+    if (sq) t->squares = sq;
+    int *ci = (int*)realloc(t->circles, sizeof(int) * cap);
+    if (ci) t->circles = ci;
+    if (!k || !sq || !ci) return 0;
+    t->cap = cap;
+    return 1;
+}
+
+void ShapeTableFree(ShapeTable *t){
+    free(t->k); free(t->squares); free(t->circles); free(t->polys);
+    *t = (ShapeTable){0};
+}
+
+// Poly pointers still point into src->polys: a copy keeps the pose fields
+// (for motion and wake checks), not a second outline cache.
+void ShapeTableCopy(ShapeTable *dst, const ShapeTable *src){
+    if (!ShapeTableReserve(dst, src->n)) return;
+    memcpy(dst->k,       src->k,       sizeof(ShapeCompiled) * src->n);
+    memcpy(dst->squares, src->squares, sizeof(int) * src->nSquares);
+    memcpy(dst->circles, src->circles, sizeof(int) * src->nCircles);
+    dst->n = src->n; dst->nSquares = src->nSquares; dst->nCircles = src->nCircles;
+}
+
+// Out of memory, the table covers a prefix of the shapes: every entry the
+// ball phase sees is complete, and a polygon never stands in as its circle.
+void ShapeTableBuild(ShapeTable *t, const Shape *shapes, int n){
+    const int want = n;
+    if (!ShapeTableReserve(t, n)) n = t->cap;
+    int nPolys = 0;
+    for (int i=0;i<n;++i) nPolys += (shapes[i].type == SHAPE_POLYGON);
+    if (nPolys > t->polyCap){
+        PolyCompiled *pc = (PolyCompiled*)realloc(t->polys, sizeof(PolyCompiled) * nPolys);
+        if (pc){ t->polys = pc; t->polyCap = nPolys; }
+        else {
+            // Old buffer kept: stop at the first polygon it has no room for
+            for (int i=0, seen=0; i<n; ++i){
+                if (shapes[i].type == SHAPE_POLYGON && seen++ == t->polyCap){ n = i; break; }
+            }
+        }
+    }
+    if (want - n != t->dropped){
+        t->dropped = want - n;
+        if (t->dropped) TraceLog(LOG_WARNING, "SHAPES: out of memory, %d of %d shapes left out of ball collisions", t->dropped, want);
+    }
+    t->n = n; t->nSquares = 0; t->nCircles = 0; t->nPolys = 0;
+    for (int i=0;i<n;++i){
+        const Shape *sh = &shapes[i];
+        ShapeCompiled *k = &t->k[i];
+        k->type = sh->type; k->x = sh->x; k->y = sh->y; k->half = sh->half; k->radius = sh->radius;
+        SimSinCosDeg(sh->angle, &k->s, &k->c);
+        k->hull  = ShapeHullRadius(sh);
+        float ext = (sh->type==SHAPE_SQUARE) ? sh->half * (fabsf(k->c) + fabsf(k->s)) : sh->radius;
+        float ex0 = -ext, ey0 = -ext, ex1 = ext, ey1 = ext;
+        k->poly = NULL;
+        if (sh->type==SHAPE_POLYGON){   // n was cut so every polygon here has a slot
+            PolyCompiled *p = &t->polys[t->nPolys++];
+            p->n = sh->nVerts;
+            ex0 = ey0 = ex1 = ey1 = 0.0f;
+            for (int v=0; v<p->n; ++v){
+                Vector2 w = RotateCS((Vector2){ sh->verts[v].x * sh->radius, sh->verts[v].y * sh->radius }, k->c, k->s);
+                p->vx[v] = w.x; p->vy[v] = w.y;
+                ex0 = fminf(ex0, w.x); ex1 = fmaxf(ex1, w.x);
+                ey0 = fminf(ey0, w.y); ey1 = fmaxf(ey1, w.y);
+            }
+            for (int v=0, w=1; v<p->n; ++v, w=(w+1 == p->n) ? 0 : w+1){
+                float dx = p->vx[w] - p->vx[v], dy = p->vy[w] - p->vy[v];
+                float len = sqrtf(dx*dx + dy*dy);
+                float inv = (len > 1e-12f) ? 1.0f / len : 0.0f;
+                p->nx[v] = -dy * inv; p->ny[v] = dx * inv;
+            }
+            k->poly = p;
+        }
+        k->sdf = NULL; k->sdfScale = 0.0f; k->sdfInv = 0.0f;
+        k->vx = k->vy = k->w = k->grow = 0.0f;
+        k->mx = k->my = k->moved = 0.0f;
+#if TEXTURE_SDF
+        if (TextureIndexOk(sh->texId) && gTexSdf[sh->texId].w > 0){
+            // Placed exactly as drawn; the hull becomes the silhouette's reach.
+            k->sdf      = &gTexSdf[sh->texId];
+            k->sdfScale = k->sdf->cellPx * TextureDrawScale(sh, gTextures[sh->texId]);
+            k->sdfInv   = 1.0f / k->sdfScale;
+            SimSinCosDeg(TextureDrawAngle(sh), &k->s, &k->c);
+            k->hull = k->sdf->reach * k->sdfScale;
+            ex0 = ey0 = -k->hull; ex1 = ey1 = k->hull;
+        }
+#endif
+        k->hull2 = k->hull * k->hull;
+        k->minX = sh->x + ex0; k->maxX = sh->x + ex1;
+        k->minY = sh->y + ey0; k->maxY = sh->y + ey1;
+        if (sh->type==SHAPE_CIRCLE) t->circles[t->nCircles++] = i;
+        else                        t->squares[t->nSquares++] = i;
+    }
+}
+
+// Shape motion from the pose at the last sim step, `elapsed` seconds ago.
+// Input just teleports shapes; this is what lets the ball phase treat them
+// as moving walls. Spin is taken from the cos/sin pair (small per-frame angles,
+// no trig). A table that was renumbered since has no motion.
+void ShapeTableSetMotion(ShapeTable *t, const ShapeTable *prev, float elapsed){
+    if (prev->n != t->n || elapsed <= 0.0f) return;
+    const float inv = 1.0f / elapsed;
+    for (int i=0;i<t->n;++i){
+        ShapeCompiled *k = &t->k[i];
+        const ShapeCompiled *a = &prev->k[i];
+        if (a->type != k->type || a->sdf != k->sdf) continue;
+        k->mx = k->x - a->x; k->my = k->y - a->y;
+        k->moved = sqrtf(k->mx*k->mx + k->my*k->my);
+        k->vx = k->mx * inv; k->vy = k->my * inv;
+        k->w  = (k->s*a->c - k->c*a->s) * inv;
+        float size0 = k->sdf ? a->sdfScale : (k->type==SHAPE_SQUARE) ? a->half : a->radius;
+        float size1 = k->sdf ? k->sdfScale : (k->type==SHAPE_SQUARE) ? k->half : k->radius;
+        k->grow = (size1 > 0.0f) ? (size1 - size0) / size1 * inv : 0.0f;
+    }
+}
+
+// ----- Shape broadphase (uniform grid) -----
+// Cell box of shape i, as the grid's user sees it.
+typedef void (*GridBoxFn)(const void *src, int i, float pad, float *x0, float *y0, float *x1, float *y1);
+
+// One fill at `cell` px; 0 when an array cannot grow (both keep their old block).
+static int ShapeGridTryFill(ShapeGrid *g, GridBoxFn box, const void *src, int n, int sw, int sh, float cell, float pad){
+    g->invCell = 1.0f / cell;
+    g->cols = (int)(sw * g->invCell) + 1;
+    g->rows = (int)(sh * g->invCell) + 1;
+    int cells = g->cols * g->rows;
+    if (cells + 1 > g->cellCap){
+        int *cs = (int*)realloc(g->cellStart, sizeof(int) * (cells + 1));
+        if (!cs) return 0;
+        g->cellStart = cs; g->cellCap = cells + 1;
+    }
+    for (int c=0;c<=cells;++c) g->cellStart[c] = 0;
+
+    // Pass 1: count per cell
+    int total = 0;
+    for (int i=0;i<n;++i){
+        float bx0,by0,bx1,by1; box(src, i, pad, &bx0,&by0,&bx1,&by1);
+        int x0,y0,x1,y1; GridCellRange(g, bx0,by0,bx1,by1, &x0,&y0,&x1,&y1);
+        for (int cy=y0;cy<=y1;++cy) for (int cx=x0;cx<=x1;++cx) g->cellStart[cy*g->cols + cx + 1]++;
+        total += (x1-x0+1) * (y1-y0+1);
+    }
+    if (total > g->itemCap){
+        int *it = (int*)realloc(g->items, sizeof(int) * (total + total/2));
+        if (!it) return 0;
+        g->items = it; g->itemCap = total + total/2;
+    }
+    // Pass 2: prefix sum, then scatter (stable → ascending indices per cell)
+    for (int c=0;c<cells;++c) g->cellStart[c+1] += g->cellStart[c];
+    for (int i=0;i<n;++i){
+        float bx0,by0,bx1,by1; box(src, i, pad, &bx0,&by0,&bx1,&by1);
+        int x0,y0,x1,y1; GridCellRange(g, bx0,by0,bx1,by1, &x0,&y0,&x1,&y1);
+        for (int cy=y0;cy<=y1;++cy) for (int cx=x0;cx<=x1;++cx) g->items[g->cellStart[cy*g->cols + cx]++] = i;
+    }
+    for (int c=cells;c>0;--c) g->cellStart[c] = g->cellStart[c-1];
+    g->cellStart[0] = 0;
+    return 1;
+}
+
+// Out of memory, cells double until both arrays fit: a coarser grid still
+// answers every query right, just slower. If even a single cell cannot be
+// had, the grid is left empty (no shapes) rather than pointing at freed or
+// stale indices.
+static void ShapeGridFill(ShapeGrid *g, GridBoxFn box, const void *src, int n, int sw, int sh, float cell, float pad){
+    for (;; cell *= 2.0f){
+        if (ShapeGridTryFill(g, box, src, n, sw, sh, cell, pad)) return;
+        if (g->cols == 1 && g->rows == 1) break;
+    }
+    TraceLog(LOG_WARNING, "GRID: out of memory, %d shapes left out of the grid", n);
+    g->cols = g->rows = 1;
+    if (g->cellStart) g->cellStart[0] = g->cellStart[1] = 0;   // any block here has room for 2
+}
+
+// Collision extents: the compiled box (silhouette reach for SDF shapes).
+static void CompiledGridBox(const void *src, int i, float pad, float *x0, float *y0, float *x1, float *y1){
+    const ShapeCompiled *k = &((const ShapeTable*)src)->k[i];
+    const float p = pad + k->moved;   // a moving shape also covers where it came from
+    *x0 = k->minX - p; *y0 = k->minY - p; *x1 = k->maxX + p; *y1 = k->maxY + p;
+}
+
+// Hit-test extents: the outline PointInShape tests, whatever the texture.
+static void OutlineGridBox(const void *src, int i, float pad, float *x0, float *y0, float *x1, float *y1){
+    const Shape *sh = &((const Shape*)src)[i];
+    const float e = ShapeHullRadius(sh) + pad;
+    *x0 = sh->x - e; *y0 = sh->y - e; *x1 = sh->x + e; *y1 = sh->y + e;
+}
+
+void ShapeGridBuild(ShapeGrid *g, const ShapeTable *t, int sw, int sh, float cell, float pad){
+    ShapeGridFill(g, CompiledGridBox, t, t->n, sw, sh, cell, pad);
+}
+
+void ShapeGridBuildHit(ShapeGrid *g, const Shape *shapes, int n, int sw, int sh, float cell, float pad){
+    ShapeGridFill(g, OutlineGridBox, shapes, n, sw, sh, cell, pad);
+}
+
+void ShapeGridFree(ShapeGrid *g){
+    free(g->cellStart); free(g->items);
+    *g = (ShapeGrid){0};
+}
+
+// Topmost shape under the pointer. Cells list shapes in ascending (draw)
+// order, so walking a cell backwards stops at the first hit. The exact test
+// runs on the live shapes, so input edits since the rebuild are honoured as
+// long as they stay within the grid's pad.
+int ShapeGridTopAt(const ShapeGrid *g, const Shape *shapes, float px, float py){
+    if (!g->cellStart) return -1;
+    int begin, it; ShapeGridCell(g, px, py, &begin, &it);
+    while (it-- > begin){
+        if (PointInShape(px, py, &shapes[g->items[it]])) return g->items[it];
+    }
+    return -1;
+}
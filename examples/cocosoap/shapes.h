@@ -0,0 +1,356 @@
+// shapes.h — shape pool, silhouette SDFs, shape↔shape push, the compiled shape table and its grid
+#ifndef SHAPES_H
+#define SHAPES_H
+#include "cocosoap.h"
+
+// ----- Texture silhouette SDF -----
+// Each texture's alpha is baked at load into a coarse signed distance field:
+// SDF_RES cells on the long side plus a transparent one-cell border, solid
+// where the cell's mean alpha reaches SDF_ALPHA_CUT. Distances come from the
+// linear-time squared Euclidean transform (Felzenszwalb & Huttenlocher), run
+// over columns then rows, once to the solid cells and once to the clear ones.
+#define SDF_FAR 1e20f
+
+typedef struct {
+    int    w, h;        // cells; 0 if the texture has no solid pixels
+    float  cellPx;      // texture px per cell
+    float  ox, oy;      // grid position of the texture centre, in cells
+    float  reach;       // farthest solid point from the texture centre, in cells
+    float *d;           // w*h signed distances in cells, negative inside
+} TexSdf;
+
+extern TexSdf gTexSdf[TEX_COUNT];
+
+int  TexSdfBake(TexSdf *s, Image *img);
+void TexSdfFree(TexSdf *s);
+
+// Distance (cells) at (u, v) cells from the texture centre, bilinear, with
+// its unnormalised gradient. Past the grid, the distance to the grid edge is
+// added on; the border ring is clear, so this only grows away from the shape.
+static inline float TexSdfSample(const TexSdf *s, float u, float v, float *gx, float *gy){
+    const float fx = u + s->ox - 0.5f, fy = v + s->oy - 0.5f;
+    const float mx = (float)(s->w - 1) - 1e-3f, my = (float)(s->h - 1) - 1e-3f;
+    const float cx = (fx < 0.0f) ? 0.0f : (fx > mx) ? mx : fx;
+    const float cy = (fy < 0.0f) ? 0.0f : (fy > my) ? my : fy;
+    const int   x0 = (int)cx, y0 = (int)cy;
+    const float tx = cx - (float)x0, ty = cy - (float)y0;
+    const float *r0 = s->d + y0*s->w + x0, *r1 = r0 + s->w;
+    const float top = r0[0] + (r0[1] - r0[0])*tx, bot = r1[0] + (r1[1] - r1[0])*tx;
+    const float dist = top + (bot - top)*ty;
+    const float ex = fx - cx, ey = fy - cy;
+    if (ex != 0.0f || ey != 0.0f){
+        *gx = ex; *gy = ey;
+        return dist + sqrtf(ex*ex + ey*ey);
+    }
+    *gx = (r0[1] - r0[0]) + ((r1[1] - r1[0]) - (r0[1] - r0[0]))*ty;
+    *gy = bot - top;
+    return dist;
+}
+
+// Texture descriptors, filled by LoadTextureBank (render.c). With TEX_ATLAS,
+// gTextures[i] only describes image i (full-size width and height, so shape
+// scale and silhouette math don't change); its pixels live in the atlas.
+extern Texture2D gTextures[TEX_COUNT];
+
+static inline int TextureOk(Texture2D t){ return (t.id != 0) && (t.width > 0) && (t.height > 0); }
+static inline int TextureIndexOk(int idx){ return (idx >= 0 && idx < TEX_COUNT && TextureOk(gTextures[idx])); }
+
+// ----- Types -----
+typedef struct {
+    ShapeType type;
+    float x, y;     // center
+    float half;     // for squares (half side)
+    float radius;   // for circles; circumradius for polygons
+    float angle;    // squares/polygons: geometry; circles: texture
+    int   texId;    // -1 = no texture; else index into gTextures[]
+    TexFit fit;     // scaling mode
+    Color tint;     // tint for texture
+    int   nVerts;                   // polygons: outline vertex count
+    Vector2 verts[POLY_MAX_VERTS];  // polygons: unit-circumradius outline, convex, wound as DrawTriangleFan wants
+} Shape;
+
+// Shapes live densely in draw order; a handle stays valid while other shapes
+// are swap-removed around it.
+typedef struct {
+    Shape *items;           // [0, count) live, index = draw order
+    int   *handleOf;        // dense index -> handle
+    int   *slotOf;          // handle -> dense index; -1 free, -2 queued for add
+    int   *freeHandles;
+    int    count, cap;
+    int    nHandles, handleCap, nFree;
+} ShapePool;
+
+// ----- Shape queries -----
+static inline int PointInSquare(float px, float py, const Shape *sq){
+    const float PI_F = 3.14159265358979323846f;
+    float a = sq->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
+    Vector2 pl = InvRotateCS((Vector2){ px - sq->x, py - sq->y }, c, s);
+    return (fabsf(pl.x) <= sq->half && fabsf(pl.y) <= sq->half);
+}
+static inline int PointInCircle(float px, float py, const Shape *sc){
+    float dx = px - sc->x, dy = py - sc->y;
+    return (dx*dx + dy*dy) <= (sc->radius*sc->radius);
+}
+// Inside every edge's half-plane. The outline winds clockwise in y-up terms,
+// so an edge's outward normal is its direction turned by (-ey, ex).
+static inline int PointInPolygon(float px, float py, const Shape *sp){
+    const float PI_F = 3.14159265358979323846f;
+    float a = sp->angle*(PI_F/180.0f), c=cosf(a), s=sinf(a);
+    Vector2 pl = InvRotateCS((Vector2){ px - sp->x, py - sp->y }, c, s);
+    pl.x /= sp->radius; pl.y /= sp->radius;
+    for (int i=0, j=sp->nVerts-1; i<sp->nVerts; j=i++){
+        float ex = sp->verts[i].x - sp->verts[j].x, ey = sp->verts[i].y - sp->verts[j].y;
+        if (-ey*(pl.x - sp->verts[j].x) + ex*(pl.y - sp->verts[j].y) > 0.0f) return 0;
+    }
+    return 1;
+}
+static inline int PointInShape(float px, float py, const Shape *sh){
+    if (sh->type==SHAPE_POLYGON) return PointInPolygon(px,py,sh);
+    return (sh->type==SHAPE_SQUARE) ? PointInSquare(px,py,sh) : PointInCircle(px,py,sh);
+}
+static inline float ShapeHullRadius(const Shape *sh){
+    return (sh->type==SHAPE_SQUARE)? (sh->half*1.41421356237f) : sh->radius;   // polygon vertices sit on the radius
+}
+// Scale and rotation DrawShapeWithTexture puts on the shape's texture.
+static inline float TextureDrawScale(const Shape *sh, Texture2D tex){
+    float side = (sh->type == SHAPE_SQUARE) ? sh->half * 2.0f : sh->radius * 2.0f;
+    float sx = side / (float)tex.width, sy = side / (float)tex.height;
+    return (sh->fit == TEX_FIT_COVER) ? fmaxf(sx, sy) : fminf(sx, sy);
+}
+static inline float TextureDrawAngle(const Shape *sh){
+    return (sh->type != SHAPE_CIRCLE || ROTATE_TEXTURES) ? sh->angle : 0.0f;
+}
+static inline void ClampShapeToWindow(Shape *sh, float sw, float shh){
+    float e = (sh->type==SHAPE_SQUARE) ? sh->half : sh->radius;
+    if (sh->x < e) sh->x = e;
+    if (sh->y < e) sh->y = e;
+    if (sh->x > sw  - e) sh->x = sw  - e;
+    if (sh->y > shh - e) sh->y = shh - e;
+}
+
+// ----- Shape pool -----
+Shape     ShapeFromInit(const ShapeInit *S);
+ShapeInit ScatteredShapeInit(int sw, int sh, int total);
+int       ShapePoolReserve(ShapePool *p, int cap);
+void      ShapePoolFree(ShapePool *p);
+int       ShapePoolNewHandle(ShapePool *p);
+int       ShapePoolPlace(ShapePool *p, int h, Shape sh);
+int       ShapePoolRemove(ShapePool *p, int h);
+
+static inline int ShapePoolAdd(ShapePool *p, Shape sh){
+    int h = ShapePoolNewHandle(p);
+    if (ShapePoolPlace(p, h, sh) < 0) return -1;
+    return h;
+}
+
+static inline Shape *ShapePoolGet(ShapePool *p, int h){
+    return (h >= 0 && h < p->nHandles && p->slotOf[h] >= 0) ? &p->items[p->slotOf[h]] : NULL;
+}
+
+// Index fix-up for anything holding a dense index across a swap-remove.
+static inline void RemapShapeIndex(int *idx, int removed, int last){
+    if (*idx == removed) *idx = -1;
+    else if (*idx == last) *idx = removed;
+}
+
+// ----- Shape↔shape push (sweep and prune) -----
+// Bounding-circle separation. Shapes are swept along x by hull interval; the
+// order persists across frames, so the insertion sort is near O(n) when
+// shapes move a little per frame.
+typedef struct {
+    int   *order;
+    float *lo;      // x - hull, the sort key
+    float *hull;
+    int    n, cap;
+} ShapeSap;
+
+int  ShapeSapReserve(ShapeSap *sap, int n);
+void ShapeSapFree(ShapeSap *sap);
+void ShapeSapAdd(ShapeSap *sap);
+void ShapeSapRemove(ShapeSap *sap, int idx);
+void ShapesPushApart(Shape *shapes, ShapeSap *sap, int activeIdx, float sw, float sh);
+
+// ----- Compiled shape table -----
+// Rebuilt once per frame after input + shape push: everything the ball phase
+// asks about a shape, with the trig, hull and bounds already worked out.
+// Polygons get their outline posed once here: vertices relative to the
+// centre and outward edge normals, so contact queries do no transforms.
+typedef struct {
+    int   n;
+    float vx[POLY_MAX_VERTS], vy[POLY_MAX_VERTS];   // vertex offsets from the shape centre, world axes
+    float nx[POLY_MAX_VERTS], ny[POLY_MAX_VERTS];   // edge i runs from vertex i to i+1
+} PolyCompiled;
+
+typedef struct {
+    int   type;
+    float x, y, half, radius;
+    float c, s;                     // cos/sin of the angle
+    float hull, hull2;              // circumscribed radius and its square
+    float minX, minY, maxX, maxY;   // tight AABB of the shape
+    const TexSdf *sdf;              // silhouette to collide with instead of the outline, or NULL
+    const PolyCompiled *poly;       // posed polygon outline, or NULL
+    float sdfScale, sdfInv;         // world px per SDF cell and its inverse
+    float vx, vy, w, grow;          // surface motion: px/s, rad/s and scale rate (1/s) about the centre
+    float mx, my, moved;            // travel since the last sim step and its length
+} ShapeCompiled;
+
+typedef struct {
+    ShapeCompiled *k;
+    int *squares, *circles;   // indices by type, ascending; polygons count as squares
+    int n, nSquares, nCircles, cap;
+    PolyCompiled *polys;      // [0, nPolys) posed outlines the polygon entries point into
+    int nPolys, polyCap;
+    int dropped;              // shapes left out of the last build for want of memory (logged on change)
+} ShapeTable;
+
+int  ShapeTableReserve(ShapeTable *t, int n);
+void ShapeTableFree(ShapeTable *t);
+void ShapeTableCopy(ShapeTable *dst, const ShapeTable *src);
+void ShapeTableBuild(ShapeTable *t, const Shape *shapes, int n);
+void ShapeTableSetMotion(ShapeTable *t, const ShapeTable *prev, float elapsed);
+
+// Signed distance (px) to a textured shape's silhouette, with the outward
+// world normal.
+static inline float CompiledSdf(const ShapeCompiled *k, float px, float py, float *nx, float *ny){
+    Vector2 pl = InvRotateCS((Vector2){ px - k->x, py - k->y }, k->c, k->s);
+    float gx, gy;
+    float d = TexSdfSample(k->sdf, pl.x * k->sdfInv, pl.y * k->sdfInv, &gx, &gy) * k->sdfScale;
+    float gl = gx*gx + gy*gy;
+    if (gl < 1e-12f){ gx = pl.x; gy = pl.y; gl = gx*gx + gy*gy; }   // flat spot: push away from the centre
+    if (gl < 1e-12f){ gx = 1.0f; gy = 0.0f; gl = 1.0f; }
+    gl = 1.0f / sqrtf(gl);
+    Vector2 n = RotateCS((Vector2){ gx*gl, gy*gl }, k->c, k->s);
+    *nx = n.x; *ny = n.y;
+    return d;
+}
+
+// Signed distance from a point at offset (dx,dy) from the centre to a posed
+// polygon, with the outward normal. Closest feature: the edge the point is
+// furthest outside of, then that edge's end vertices. Inside, the nearest
+// edge wins.
+static inline float PolyDistanceNormal(const PolyCompiled *p, float dx, float dy, float *nx, float *ny){
+    int e = 0;
+    float sep = -3.4e38f;
+    for (int i=0;i<p->n;++i){
+        float si = p->nx[i]*(dx - p->vx[i]) + p->ny[i]*(dy - p->vy[i]);
+        if (si > sep){ sep = si; e = i; }
+    }
+    *nx = p->nx[e]; *ny = p->ny[e];
+    if (sep <= 0.0f) return sep;
+    int f = (e+1 == p->n) ? 0 : e+1;
+    float ax = dx - p->vx[e], ay = dy - p->vy[e];
+    float ex = p->vx[f] - p->vx[e], ey = p->vy[f] - p->vy[e];
+    float u = ax*ex + ay*ey;
+    if (u > 0.0f && u < ex*ex + ey*ey) return sep;   // face region
+    if (u > 0.0f){ ax = dx - p->vx[f]; ay = dy - p->vy[f]; }
+    float d = sqrtf(ax*ax + ay*ay);
+    if (d > 1e-6f){ *nx = ax/d; *ny = ay/d; }
+    return d;
+}
+
+static inline int PolyContains(const PolyCompiled *p, float dx, float dy){
+    for (int i=0;i<p->n;++i){
+        if (p->nx[i]*(dx - p->vx[i]) + p->ny[i]*(dy - p->vy[i]) > 0.0f) return 0;
+    }
+    return 1;
+}
+
+static inline int CompiledPointIn(const ShapeCompiled *k, float px, float py){
+    if (px < k->minX || px > k->maxX || py < k->minY || py > k->maxY) return 0;
+    if (k->sdf){ float nx, ny; return CompiledSdf(k, px, py, &nx, &ny) <= 0.0f; }
+    float dx = px - k->x, dy = py - k->y;
+    if (k->poly) return PolyContains(k->poly, dx, dy);
+    if (k->type != SHAPE_SQUARE) return (dx*dx + dy*dy) <= (k->radius*k->radius);
+    Vector2 pl = InvRotateCS((Vector2){ dx, dy }, k->c, k->s);
+    return (fabsf(pl.x) <= k->half && fabsf(pl.y) <= k->half);
+}
+
+// Signed distance from a point to the compiled shape (negative inside).
+static inline float CompiledDistance(const ShapeCompiled *k, float px, float py){
+    if (k->sdf){ float nx, ny; return CompiledSdf(k, px, py, &nx, &ny); }
+    float dx = px - k->x, dy = py - k->y;
+    if (k->poly){ float nx, ny; return PolyDistanceNormal(k->poly, dx, dy, &nx, &ny); }
+    if (k->type != SHAPE_SQUARE) return sqrtf(dx*dx + dy*dy) - k->radius;
+    Vector2 pl = InvRotateCS((Vector2){ dx, dy }, k->c, k->s);
+    float qx = fabsf(pl.x) - k->half, qy = fabsf(pl.y) - k->half;
+    float ox = (qx > 0.0f) ? qx : 0.0f, oy = (qy > 0.0f) ? qy : 0.0f;
+    float in = (qx > qy) ? qx : qy;
+    return sqrtf(ox*ox + oy*oy) + ((in < 0.0f) ? in : 0.0f);
+}
+
+// CompiledDistance plus the outward unit normal (its gradient).
+static inline float CompiledDistanceNormal(const ShapeCompiled *k, float px, float py, float *nx, float *ny){
+    if (k->sdf) return CompiledSdf(k, px, py, nx, ny);
+    float dx = px - k->x, dy = py - k->y;
+    if (k->poly) return PolyDistanceNormal(k->poly, dx, dy, nx, ny);
+    if (k->type != SHAPE_SQUARE){
+        float d = sqrtf(dx*dx + dy*dy);
+        if (d > 1e-6f){ *nx = dx/d; *ny = dy/d; } else { *nx = 1.0f; *ny = 0.0f; }
+        return d - k->radius;
+    }
+    Vector2 pl = InvRotateCS((Vector2){ dx, dy }, k->c, k->s);
+    float qx = fabsf(pl.x) - k->half, qy = fabsf(pl.y) - k->half, d;
+    Vector2 nl;
+    if (qx > 0.0f || qy > 0.0f){
+        float ox = (qx > 0.0f) ? qx : 0.0f, oy = (qy > 0.0f) ? qy : 0.0f;
+        d  = sqrtf(ox*ox + oy*oy);
+        nl = (Vector2){ copysignf(ox/d, pl.x), copysignf(oy/d, pl.y) };
+    } else if (qx > qy){
+        d = qx; nl = (Vector2){ copysignf(1.0f, pl.x), 0.0f };   // nearest face wins inside
+    } else {
+        d = qy; nl = (Vector2){ 0.0f, copysignf(1.0f, pl.y) };
+    }
+    Vector2 n = RotateCS(nl, k->c, k->s);
+    *nx = n.x; *ny = n.y;
+    return d;
+}
+
+// ----- Shape broadphase (uniform grid) -----
+// Shapes are bucketed by AABB once per frame (counting sort over cell ids).
+// The AABB is inflated by the largest per-ball reach of the frame, so a ball
+// only has to look at the single cell containing its center.
+typedef struct {
+    float invCell;
+    int   cols, rows;
+    int  *cellStart;    // cols*rows+1 offsets into items
+    int  *items;        // shape indices grouped by cell, ascending within a cell
+    int   cellCap, itemCap;
+} ShapeGrid;
+
+static inline void GridCellRange(const ShapeGrid *g, float minX, float minY, float maxX, float maxY,
+                                 int *cx0, int *cy0, int *cx1, int *cy1){
+    int x0 = (int)(minX * g->invCell), y0 = (int)(minY * g->invCell);
+    int x1 = (int)(maxX * g->invCell), y1 = (int)(maxY * g->invCell);
+    // Clamp both ends: off-window boxes and points land in the border cells
+    x0 = (x0 < 0) ? 0 : (x0 > g->cols-1) ? g->cols-1 : x0;
+    y0 = (y0 < 0) ? 0 : (y0 > g->rows-1) ? g->rows-1 : y0;
+    x1 = (x1 < 0) ? 0 : (x1 > g->cols-1) ? g->cols-1 : x1;
+    y1 = (y1 < 0) ? 0 : (y1 > g->rows-1) ? g->rows-1 : y1;
+    *cx0 = x0; *cy0 = y0; *cx1 = x1; *cy1 = y1;
+}
+
+void ShapeGridBuild(ShapeGrid *g, const ShapeTable *t, int sw, int sh, float cell, float pad);
+// Pointer hit-testing goes through PointInShape, so its grid is built from the
+// shapes' own outlines: a textured shape's silhouette can reach past or fall
+// short of them.
+void ShapeGridBuildHit(ShapeGrid *g, const Shape *shapes, int n, int sw, int sh, float cell, float pad);
+void ShapeGridFree(ShapeGrid *g);
+int  ShapeGridTopAt(const ShapeGrid *g, const Shape *shapes, float px, float py);
+
+// Shapes registered in the cell containing (px,py): [*begin, *end) into g->items.
+static inline void ShapeGridCell(const ShapeGrid *g, float px, float py, int *begin, int *end){
+    if (!g->cellStart){ *begin = *end = 0; return; }   // never built, or out of memory on the first build
+    int cx,cy,cx1,cy1; GridCellRange(g, px, py, px, py, &cx,&cy,&cx1,&cy1);
+    int c = cy*g->cols + cx;
+    *begin = g->cellStart[c]; *end = g->cellStart[c+1];
+}
+
+static inline int ShapeGridPointInAny(const ShapeGrid *g, const ShapeTable *t, float px, float py){
+    int it, end; ShapeGridCell(g, px, py, &it, &end);
+    for (; it<end; ++it){
+        if (CompiledPointIn(&t->k[g->items[it]], px, py)) return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,1070 @@
+// sim.c — ball store, free-space spawning, sleep, compact store, sweeps, depenetration and the sim step
+#include "sim.h"
+#include "collide.h"
+#include "simd.h"
+#include "pool.h"
+
+SimRng gSimRng = { 0, 0 };
+
+// ----- Ball store -----
+int BallStoreInit(BallStore *bs, int cap){
+    *bs = (BallStore){0};
+    bs->cap = cap;
+    bs->x   = (float*)malloc(sizeof(float) * cap);
+    bs->y   = (float*)malloc(sizeof(float) * cap);
+    bs->px  = (float*)malloc(sizeof(float) * cap);
+    bs->py  = (float*)malloc(sizeof(float) * cap);
+    bs->vx  = (float*)malloc(sizeof(float) * cap);
+    bs->vy  = (float*)malloc(sizeof(float) * cap);
+    bs->r   = (float*)malloc(sizeof(float) * cap);
+    bs->col = (Color*)malloc(sizeof(Color) * cap);
+    return bs->x && bs->y && bs->px && bs->py && bs->vx && bs->vy && bs->r && bs->col;
+}
+void BallStoreFree(BallStore *bs){
+    free(bs->x); free(bs->y); free(bs->px); free(bs->py); free(bs->vx); free(bs->vy); free(bs->r); free(bs->col);
+    *bs = (BallStore){0};
+}
+// Grows every lane to cap; on failure the store keeps its old capacity.
+int BallStoreReserve(BallStore *bs, int cap){
+    if (cap <= bs->cap) return 1;
+    float **lanes[7] = { &bs->x, &bs->y, &bs->px, &bs->py, &bs->vx, &bs->vy, &bs->r };
+    for (int l=0;l<7;++l){
+        float *p = (float*)realloc(*lanes[l], sizeof(float) * cap);
+        if (!p) return 0;
+        *lanes[l] = p;
+    }
+    Color *c = (Color*)realloc(bs->col, sizeof(Color) * cap);
+    if (!c) return 0;
+    bs->col = c;
+    bs->cap = cap;
+    return 1;
+}
+
+// ----- Ball helpers -----
+static inline void AssignBallKinematicsAndColor(BallStore *bs, int i){
+    float angle = (float)SimRandInt(0, 359);
+    float speed = (float)SimRandInt((int)SPEED_MIN, (int)SPEED_MAX);
+    float t01   = (float)SimRandInt(0,1000)/1000.0f;
+    float sa, ca; SimSinCosDeg(angle, &sa, &ca);
+    bs->r[i]   = BALL_RADIUS_MIN + t01 * (BALL_RADIUS_MAX - BALL_RADIUS_MIN);
+    bs->col[i] = GradientSample(GRADIENT_STOPS, GRADIENT_COUNT, t01);
+    bs->vx[i]  = ca * speed;
+    bs->vy[i]  = sa * speed;
+    if (fabsf(bs->vx[i]) < 1e-3f && fabsf(bs->vy[i]) < 1e-3f){ bs->vx[i] = speed; bs->vy[i] = 0.0f; }
+}
+
+// Circles first: their test is a single distance check.
+// A ball of radius r at (px, py) touches some shape (any type, silhouette
+// included), or pokes out of the sw x sh frame.
+static int BallBlocked(const ShapeTable *t, float px, float py, float r, float sw, float sh){
+    if (px < r || px > sw - r || py < r || py > sh - r) return 1;
+    for (int i=0;i<t->n;++i){
+        const ShapeCompiled *k = &t->k[i];
+        float dx = px - k->x, dy = py - k->y, reach = k->hull + r;
+        if (dx*dx + dy*dy > reach*reach) continue;
+        if (CompiledDistance(k, px, py) < r) return 1;
+    }
+    return 0;
+}
+
+// ----- Free-space spawn map -----
+static inline void PushOutsideHull(const ShapeCompiled *sh, float r, float *bx, float *by){
+    float dx = *bx - sh->x, dy = *by - sh->y;
+    float len2 = dx*dx + dy*dy;
+    float minD = sh->hull + r + SPAWN_MARGIN;
+    float minD2 = minD*minD;
+    if (len2 < 1e-8f){ dx=1.0f; dy=0.0f; len2=1.0f; }
+    if (len2 < minD2){
+        float s = minD / sqrtf(len2);
+        *bx = sh->x + dx*s; *by = sh->y + dy*s;
+    }
+}
+
+// Same clearance field: only what CompiledDistance reads. Motion fields
+// change every frame and bounds follow from the pose, so neither counts;
+// outlines are compared by vertex (normals follow from those).
+static int SpawnShapeSame(const ShapeCompiled *a, const ShapeCompiled *b){
+    if (a->type != b->type || a->x != b->x || a->y != b->y || a->half != b->half || a->radius != b->radius ||
+        a->c != b->c || a->s != b->s || a->sdf != b->sdf || a->sdfScale != b->sdfScale) return 0;
+    if (!a->poly || !b->poly) return a->poly == b->poly;
+    if (a->poly->n != b->poly->n) return 0;
+    for (int v=0; v<a->poly->n; ++v){
+        if (a->poly->vx[v] != b->poly->vx[v] || a->poly->vy[v] != b->poly->vy[v]) return 0;
+    }
+    return 1;
+}
+
+// Cheap per-frame check; the rebuild itself is deferred to SpawnMapSample.
+// The map keeps its own outlines: the table's are rewritten every frame.
+void SpawnMapUpdate(SpawnMap *m, const ShapeTable *t, int sw, int sh){
+    if (m->valid && m->sw == sw && m->sh == sh && m->lastN == t->n){
+        int i = 0;
+        while (i < t->n && SpawnShapeSame(&m->last[i], &t->k[i])) ++i;
+        if (i == t->n) return;
+    }
+    if (t->n > m->lastCap){
+        ShapeCompiled *last = (ShapeCompiled*)realloc(m->last, sizeof(ShapeCompiled) * t->n);
+        if (!last){ m->valid = 0; return; }   // rejection respawns until a later frame has the memory
+        m->last = last; m->lastCap = t->n;
+    }
+    int nPolys = 0;
+    for (int i=0;i<t->n;++i) nPolys += (t->k[i].poly != NULL);
+    if (nPolys > m->lastPolyCap){
+        PolyCompiled *lp = (PolyCompiled*)realloc(m->lastPolys, sizeof(PolyCompiled) * nPolys);
+        if (!lp){ m->valid = 0; return; }
+        m->lastPolys = lp; m->lastPolyCap = nPolys;
+    }
+    memcpy(m->last, t->k, sizeof(ShapeCompiled) * t->n);
+    for (int i=0, j=0; i<t->n; ++i){
+        if (!m->last[i].poly) continue;
+        m->lastPolys[j] = *m->last[i].poly;
+        m->last[i].poly = &m->lastPolys[j++];
+    }
+    m->lastN = t->n; m->sw = sw; m->sh = sh;
+    m->valid = 1; m->stale = 1;
+}
+
+static void SpawnMapRebuild(SpawnMap *m){
+    const float cell = SPAWN_CELL_PX, inv = 1.0f / SPAWN_CELL_PX;
+    const float hd   = cell * 0.70710678f;   // cell centre to corner
+    const float cap  = (float)SPAWN_CLEAR_CAP;
+    m->cols = (int)(m->sw * inv); m->rows = (int)(m->sh * inv);
+    int cells = m->cols * m->rows;
+    if (cells > m->cellCap){
+        unsigned char *cl = (unsigned char*)realloc(m->clear, (size_t)cells);
+        if (cl) m->clear = cl;
+        int *ce = (int*)realloc(m->cells, sizeof(int) * cells);
+        if (ce) m->cells = ce;
+        if (!cl || !ce){ m->valid = 0; m->stale = 0; return; }   // next SpawnMapUpdate retries
+        m->cellCap = cells;
+    }
+
+    // Walls: exact per-axis distance from the cell's nearest edge
+    for (int cy=0; cy<m->rows; ++cy){
+        float y0 = cy*cell, dy = fminf(y0, m->sh - (y0 + cell));
+        for (int cx=0; cx<m->cols; ++cx){
+            float x0 = cx*cell, d = fminf(dy, fminf(x0, m->sw - (x0 + cell)));
+            m->clear[cy*m->cols + cx] = (unsigned char)((d <= 0.0f) ? 0.0f : fminf(d, cap));
+        }
+    }
+    // Shapes: only cells whose clearance could drop below the cap are visited
+    const float reach = cap + SPAWN_MARGIN + hd;
+    for (int i=0;i<m->lastN;++i){
+        const ShapeCompiled *k = &m->last[i];
+        int x0 = (int)fmaxf((k->minX - reach) * inv, 0.0f), y0 = (int)fmaxf((k->minY - reach) * inv, 0.0f);
+        int x1 = (int)((k->maxX + reach) * inv),            y1 = (int)((k->maxY + reach) * inv);
+        if (x1 > m->cols-1) x1 = m->cols-1; if (y1 > m->rows-1) y1 = m->rows-1;
+        for (int cy=y0; cy<=y1; ++cy){
+            for (int cx=x0; cx<=x1; ++cx){
+                unsigned char *c = &m->clear[cy*m->cols + cx];
+                if (*c == 0) continue;
+                float d = CompiledDistance(k, (cx + 0.5f)*cell, (cy + 0.5f)*cell) - SPAWN_MARGIN - hd;
+                if (d < (float)*c) *c = (unsigned char)((d <= 0.0f) ? 0.0f : d);
+            }
+        }
+    }
+
+    // Counting sort by clearance, descending
+    int count[SPAWN_CLEAR_CAP + 1] = {0};
+    for (int c=0;c<cells;++c) count[m->clear[c]]++;
+    m->atLeast[SPAWN_CLEAR_CAP + 1] = 0;
+    for (int v=SPAWN_CLEAR_CAP; v>=0; --v) m->atLeast[v] = m->atLeast[v+1] + count[v];
+    int fill[SPAWN_CLEAR_CAP + 1];
+    for (int v=0; v<=SPAWN_CLEAR_CAP; ++v) fill[v] = m->atLeast[v+1];
+    for (int c=0;c<cells;++c) m->cells[fill[m->clear[c]]++] = c;
+    m->stale = 0;
+}
+
+void SpawnMapFree(SpawnMap *m){
+    free(m->clear); free(m->cells); free(m->last); free(m->lastPolys);
+    *m = (SpawnMap){0};
+}
+
+// Uniform point in a random cell with clearance >= r; 0 when there is none.
+static int SpawnMapSample(SpawnMap *m, float r, float *x, float *y){
+    if (!m || !m->valid) return 0;
+    if (m->stale) SpawnMapRebuild(m);
+    if (!m->valid) return 0;
+    int need = (int)ceilf(r);
+    if (need < 1) need = 1;
+    if (need > SPAWN_CLEAR_CAP) return 0;
+    int n = m->atLeast[need];
+    if (n == 0) return 0;
+    int c = m->cells[SimRandInt(0, n - 1)];
+    *x = ((float)(c % m->cols) + (float)SimRandInt(0, 1000) / 1000.0f) * SPAWN_CELL_PX;
+    *y = ((float)(c / m->cols) + (float)SimRandInt(0, 1000) / 1000.0f) * SPAWN_CELL_PX;
+    return 1;
+}
+
+// Free-space sample when the map has room; otherwise polar tries around the
+// middle of the sw x sh frame, then uniform tries, then a pushed-out fallback.
+void RespawnBallOutsideAllShapes(BallStore *bs, int bi, const ShapeTable *t, SpawnMap *map, float sw, float sh){
+    const ShapeCompiled *shapes = t->k;
+    const int n = t->n;
+    AssignBallKinematicsAndColor(bs, bi);
+    if (SpawnMapSample(map, bs->r[bi], &bs->x[bi], &bs->y[bi])) return;
+    const float seedX = sw*0.5f, seedY = sh*0.5f;
+    const float br = bs->r[bi];
+
+    for (int tries=0; tries<256; ++tries){
+        float ang = (float)SimRandInt(0, 359);
+        float maxHull = 0.0f;
+        for (int i=0;i<n;++i){
+            float dx = seedX - shapes[i].x, dy = seedY - shapes[i].y;
+            float d  = sqrtf(dx*dx + dy*dy);
+            float hull = d + shapes[i].hull + br + SPAWN_MARGIN;
+            if (hull > maxHull) maxHull = hull;
+        }
+        float extra  = (float)SimRandInt(0, 200);
+        float radial = (maxHull > 0.0f ? maxHull : 200.0f) + extra;
+
+        float sa, ca; SimSinCosDeg(ang, &sa, &ca);
+        float x = seedX + ca * radial;
+        float y = seedY + sa * radial;
+
+        if (x < br) x = br; if (x > sw - br) x = sw - br;
+        if (y < br) y = br; if (y > sh - br) y = sh - br;
+
+        for (int i=0;i<n;++i) PushOutsideHull(&shapes[i], br, &x, &y);
+
+        // The pushes can land past a wall or on a neighbour: keep only clear spots
+        if (!BallBlocked(t, x, y, br, sw, sh)){ bs->x[bi] = x; bs->y[bi] = y; return; }
+    }
+
+    for (int tries=0; tries<2048; ++tries){
+        float x = (float)SimRandInt((int)ceilf(br), (int)(sw - br));
+        float y = (float)SimRandInt((int)ceilf(br), (int)(sh - br));
+        if (!BallBlocked(t, x, y, br, sw, sh)){ bs->x[bi] = x; bs->y[bi] = y; return; }
+    }
+    // No clear spot: the window is full. Top middle, pushed out, kept inside
+    float x = sw*0.5f, y = BALL_RADIUS_MAX + SPAWN_MARGIN;
+    for (int i=0;i<n;++i) PushOutsideHull(&shapes[i], br, &x, &y);
+    x = fminf(fmaxf(x, br), sw - br); y = fminf(fmaxf(y, br), sh - br);
+    bs->x[bi] = x; bs->y[bi] = y;
+}
+
+// ----- Ball sleep -----
+// Sleeping balls sit in the tail of the store, so every sim phase just runs
+// over [0, awake). Waking or sleeping a ball swaps it across the boundary.
+static inline void BallStoreSwap(BallStore *bs, int i, int j){
+    float t;
+    t = bs->x[i];  bs->x[i]  = bs->x[j];  bs->x[j]  = t;
+    t = bs->y[i];  bs->y[i]  = bs->y[j];  bs->y[j]  = t;
+    t = bs->px[i]; bs->px[i] = bs->px[j]; bs->px[j] = t;
+    t = bs->py[i]; bs->py[i] = bs->py[j]; bs->py[j] = t;
+    t = bs->vx[i]; bs->vx[i] = bs->vx[j]; bs->vx[j] = t;
+    t = bs->vy[i]; bs->vy[i] = bs->vy[j]; bs->vy[j] = t;
+    t = bs->r[i];  bs->r[i]  = bs->r[j];  bs->r[j]  = t;
+    Color c = bs->col[i]; bs->col[i] = bs->col[j]; bs->col[j] = c;
+}
+
+static inline int BallIsResting(const BallStore *bs, int i){
+    return bs->vx[i]*bs->vx[i] + bs->vy[i]*bs->vy[i] < SLEEP_SPEED*SLEEP_SPEED;
+}
+
+// After the sim: resting awake balls go to sleep (frozen at x/y so they draw
+// still), and sleepers that picked up speed (ball-ball hit, respawn) wake.
+void BallsUpdateSleep(BallStore *bs){
+    for (int i=bs->awake-1; i>=0; --i){
+        if (!BallIsResting(bs, i)) continue;
+        bs->px[i] = bs->x[i]; bs->py[i] = bs->y[i];
+        BallStoreSwap(bs, i, --bs->awake);
+    }
+    for (int i=bs->awake; i<bs->count; ++i)
+        if (!BallIsResting(bs, i)) BallStoreSwap(bs, i, bs->awake++);
+}
+
+// Before the sim: wake sleepers touched by any shape that changed since the
+// last frame. The swept hull is the capsule between the old and new centres.
+// Adding or removing shapes renumbers them, so that wakes everyone.
+// Pose only: padding, the posed-outline pointer (rebound by ShapeTableCopy)
+// and the motion fields would make an unmoved shape look moved.
+static inline int CompiledSamePose(const ShapeCompiled *a, const ShapeCompiled *b){
+    return a->type == b->type && a->x == b->x && a->y == b->y && a->c == b->c && a->s == b->s &&
+           a->half == b->half && a->radius == b->radius && a->sdf == b->sdf && a->sdfScale == b->sdfScale;
+}
+
+void BallsWakeNearMovedShapes(BallStore *bs, const ShapeTable *prev, const ShapeTable *cur){
+    if (bs->awake == bs->count) return;
+    if (prev->n != cur->n){ bs->awake = bs->count; return; }
+    for (int k=0;k<cur->n;++k){
+        const ShapeCompiled *a = &prev->k[k], *b = &cur->k[k];
+        if (CompiledSamePose(a, b)) continue;
+        const float minX = fminf(a->minX, b->minX), maxX = fmaxf(a->maxX, b->maxX);
+        const float minY = fminf(a->minY, b->minY), maxY = fmaxf(a->maxY, b->maxY);
+        const float sx = b->x - a->x, sy = b->y - a->y;
+        const float len2 = sx*sx + sy*sy;
+        const float hull = fmaxf(a->hull, b->hull);
+        for (int i=bs->awake; i<bs->count; ++i){
+            const float bx = bs->x[i], by = bs->y[i], br = bs->r[i];
+            if (bx + br < minX || bx - br > maxX || by + br < minY || by - br > maxY) continue;
+            float u = (len2 > 0.0f) ? ((bx - a->x)*sx + (by - a->y)*sy) / len2 : 0.0f;
+            u = (u < 0.0f) ? 0.0f : (u > 1.0f) ? 1.0f : u;
+            float dx = bx - (a->x + sx*u), dy = by - (a->y + sy*u);
+            float reach = hull + br;
+            if (dx*dx + dy*dy <= reach*reach) BallStoreSwap(bs, i, bs->awake++);
+        }
+    }
+}
+
+// Grows by spawning into free space (new balls start awake) and shrinks by
+// dropping the tail, which is where the sleepers are.
+int BallsSetCount(BallStore *bs, int n, const ShapeTable *t, SpawnMap *map, float sw, float sh){
+    if (n < 0) n = 0;
+    if (n > bs->cap && !BallStoreReserve(bs, (bs->cap * 2 > n) ? bs->cap * 2 : n)) return 0;
+    while (bs->count < n){
+        int i = bs->count++;
+        RespawnBallOutsideAllShapes(bs, i, t, map, sw, sh);
+        bs->px[i] = bs->x[i]; bs->py[i] = bs->y[i];
+        BallStoreSwap(bs, i, bs->awake++);
+    }
+    bs->count = n;
+    if (bs->awake > n) bs->awake = n;
+    return 1;
+}
+
+#if COMPACT_BALLS
+// ----- Compact ball store -----
+float gBallRadiusLut[256];
+Color gBallPaletteLut[256];
+
+void BallLutsInit(void){
+    for (int i=0;i<256;++i){
+        float t = (float)i / 255.0f;
+        gBallRadiusLut[i]  = BALL_RADIUS_MIN + t * (BALL_RADIUS_MAX - BALL_RADIUS_MIN);
+        gBallPaletteLut[i] = GradientSample(GRADIENT_STOPS, GRADIENT_COUNT, t);
+    }
+}
+
+// Round to nearest; no subnormals or infinities are ever written (tiny
+// speeds flush to zero, huge ones clamp to the largest finite half).
+static inline uint16_t HalfFromFloat(float f){
+    uint32_t u; memcpy(&u, &f, sizeof(u));
+    uint32_t sign = (u >> 16) & 0x8000u, m = u & 0x7fffffu;
+    int32_t  e = (int32_t)((u >> 23) & 0xffu) - 127 + 15;
+    if (e <= 0)  return (uint16_t)sign;
+    if (e >= 31) return (uint16_t)(sign | 0x7bffu);
+    uint32_t h = (sign | ((uint32_t)e << 10) | (m >> 13)) + ((m >> 12) & 1u);   // a mantissa carry bumps the exponent
+    if ((h & 0x7c00u) == 0x7c00u) h = sign | 0x7bffu;
+    return (uint16_t)h;
+}
+
+// Palette index of the point on the GRADIENT_STOPS polyline nearest to c
+// (RGBA). Colours off the gradient snap onto it.
+static inline uint8_t PaletteIndexOf(Color c){
+    if (GRADIENT_COUNT < 2) return 0;
+    float bestD = 1e30f, bestT = 0.0f;
+    for (int s=0; s+1<GRADIENT_COUNT; ++s){
+        const Color a = GRADIENT_STOPS[s], b = GRADIENT_STOPS[s+1];
+        const float d[4] = { (float)(b.r - a.r), (float)(b.g - a.g), (float)(b.b - a.b), (float)(b.a - a.a) };
+        const float v[4] = { (float)(c.r - a.r), (float)(c.g - a.g), (float)(c.b - a.b), (float)(c.a - a.a) };
+        float dd = 0.0f, vd = 0.0f;
+        for (int k=0;k<4;++k){ dd += d[k]*d[k]; vd += v[k]*d[k]; }
+        float u = (dd > 0.0f) ? vd / dd : 0.0f;
+        u = (u < 0.0f) ? 0.0f : (u > 1.0f) ? 1.0f : u;
+        float dist = 0.0f;
+        for (int k=0;k<4;++k){ float e = v[k] - u*d[k]; dist += e*e; }
+        if (dist < bestD){ bestD = dist; bestT = ((float)s + u) / (float)(GRADIENT_COUNT - 1); }
+    }
+    return (uint8_t)(bestT * 255.0f + 0.5f);
+}
+
+static inline uint16_t PackUnit(float v, float scale){
+    float q = v * scale + 0.5f;
+    return (uint16_t)((q <= 0.0f) ? 0.0f : (q >= 65535.0f) ? 65535.0f : q);
+}
+
+int BallPackedReserve(BallPackedStore *p, int cap){
+    if (cap <= p->cap) return 1;
+    BallPacked *b = (BallPacked*)realloc(p->b, sizeof(BallPacked) * cap);
+    if (!b) return 0;
+    p->b = b; p->cap = cap;
+    return 1;
+}
+
+void BallPackedFree(BallPackedStore *p){
+    free(p->b);
+    *p = (BallPackedStore){0};
+}
+
+// Balls [begin, begin+n) into w[0, n), all awake. px/py start at the
+// current position.
+void BallsUnpack(const BallPackedStore *p, int begin, int n, BallStore *w){
+    const float sx = p->sw / 65535.0f, sy = p->sh / 65535.0f;
+    for (int i=0;i<n;++i){
+        const BallPacked *q = &p->b[begin + i];
+        w->x[i]  = w->px[i] = (float)q->x * sx;
+        w->y[i]  = w->py[i] = (float)q->y * sy;
+        w->vx[i] = FloatFromHalf(q->vx);
+        w->vy[i] = FloatFromHalf(q->vy);
+        w->r[i]  = gBallRadiusLut[q->r];
+        w->col[i] = gBallPaletteLut[q->col];
+    }
+    w->count = w->awake = n;
+}
+
+// w[0, count) back into balls [begin, ...), positions against sw x sh.
+void BallsPack(BallPackedStore *p, int begin, const BallStore *w, float sw, float sh){
+    const float sx = 65535.0f / sw, sy = 65535.0f / sh;
+    const float rs = 255.0f / (BALL_RADIUS_MAX - BALL_RADIUS_MIN);
+    for (int i=0;i<w->count;++i){
+        BallPacked *q = &p->b[begin + i];
+        q->x  = PackUnit(w->x[i], sx);
+        q->y  = PackUnit(w->y[i], sy);
+        q->vx = HalfFromFloat(w->vx[i]);
+        q->vy = HalfFromFloat(w->vy[i]);
+        q->r  = (uint8_t)PackUnit(w->r[i] - BALL_RADIUS_MIN, rs);
+        q->col = PaletteIndexOf(w->col[i]);
+    }
+}
+
+// BallsSetCount for the packed store: new balls are spawned in chunks
+// through w, which is left holding garbage.
+int BallsPackedSetCount(BallPackedStore *p, BallStore *w, int n, const ShapeTable *t, SpawnMap *map,
+                               float sw, float sh){
+    if (n < 0) n = 0;
+    if (n > p->cap && !BallPackedReserve(p, (p->cap * 2 > n) ? p->cap * 2 : n)) return 0;
+    while (p->count < n){
+        int m = (n - p->count < w->cap) ? n - p->count : w->cap;
+        for (int i=0;i<m;++i) RespawnBallOutsideAllShapes(w, i, t, map, sw, sh);
+        w->count = m;
+        BallsPack(p, p->count, w, p->sw, p->sh);
+        p->count += m;
+    }
+    p->count = n;
+    return 1;
+}
+#endif
+
+#if DETERMINISTIC
+// ----- State hash -----
+// 64-bit hash of the bits of every ball and shape, for replay checks. Four
+// independent multiply-xor lanes keep it around a word per cycle.
+static inline uint32_t FloatBits(float f){ uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+
+static inline void HashFloats(uint64_t h[4], const float *w, int n){
+    int i = 0;
+    for (; i + 4 <= n; i += 4){
+        h[0] = (h[0] ^ FloatBits(w[i  ])) * 0x100000001B3ull;
+        h[1] = (h[1] ^ FloatBits(w[i+1])) * 0x100000001B3ull;
+        h[2] = (h[2] ^ FloatBits(w[i+2])) * 0x100000001B3ull;
+        h[3] = (h[3] ^ FloatBits(w[i+3])) * 0x100000001B3ull;
+    }
+    for (; i < n; ++i) h[0] = (h[0] ^ FloatBits(w[i])) * 0x100000001B3ull;
+}
+
+uint64_t SimStateHash(const BallStore *bs, const Shape *shapes, int nShapes){
+    uint64_t h[4] = { 0xCBF29CE484222325ull, 0x84222325CBF29CE4ull, 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full };
+    const float *lanes[5] = { bs->x, bs->y, bs->vx, bs->vy, bs->r };
+    for (int l=0;l<5;++l) HashFloats(h, lanes[l], bs->count);
+    for (int i=0;i<nShapes;++i){
+        const float f[5] = { shapes[i].x, shapes[i].y, shapes[i].half, shapes[i].radius, shapes[i].angle };
+        HashFloats(h, f, 5);
+    }
+    uint64_t out = (uint64_t)bs->count * 0x9E3779B97F4A7C15ull ^ (uint64_t)bs->awake;
+    for (int k=0;k<4;++k){ out ^= h[k] + 0x9E3779B97F4A7C15ull + (out << 6) + (out >> 2); }
+    return out;
+}
+#endif
+
+// ----- Ball integrate + wall reflect (vectorizable) -----
+// Per-ball plan for the frame: steps[i] in 1..maxSteps, sdt[i] = dt/steps, and
+// reach[i] = how far from its start the ball can touch anything (travel + push
+// slack). Returns the largest reach, used to inflate the shape grid.
+static float PlanBallSubsteps(const float *restrict vx, const float *restrict vy, const float *restrict r,
+                              int *restrict steps, float *restrict sdt, float *restrict reach, int n, float dt,
+                              int maxSteps){
+    float maxReach = 0.0f;
+    for (int i=0;i<n;++i){
+        float u = vx[i], v = vy[i], d = r[i]*2.0f;
+        float spd  = sqrtf(u*u + v*v);
+        float span = (d > 2.0f) ? d : 2.0f;
+        int   k    = 1 + (int)((spd * dt) / span);
+#if SUBSTEP_BUCKETS
+        k = (k > 4) ? 8 : (k > 2) ? 4 : k;   // round up to the bucket's power of two
+#endif
+        k = (k > maxSteps) ? maxSteps : k;
+        steps[i] = k;
+        sdt[i]   = dt / (float)k;
+        float p  = d + spd*dt + SEP_BIAS;
+        reach[i] = p;
+        maxReach = (p > maxReach) ? p : maxReach;
+    }
+    return maxReach;
+}
+
+// Substep buckets: 1, 2, 4 and 8 steps. Balls that are awake are reordered,
+// most steps first, so the balls still moving in substep `sub` are
+// [0, bucketEnd[j]) for the first bucket j with 2^j > sub. This is an
+// in-place counting sort (cycle leader) over the ball store and the plan
+// arrays. It runs serially on the whole range, so the order does not depend
+// on the thread count. Bucket populations barely change between frames, so
+// it usually swaps almost nothing.
+
+static inline int StepBucket(int steps){ return (steps > 4) ? 3 : (steps > 2) ? 2 : steps - 1; }
+
+#if SUBSTEP_BUCKETS
+static void BallsSortBySteps(BallStore *bs, int *steps, float *sdt, float *reach, int n, int bucketEnd[STEP_BUCKETS]){
+    int count[STEP_BUCKETS] = {0}, next[STEP_BUCKETS], end[STEP_BUCKETS];
+    for (int i=0;i<n;++i) ++count[StepBucket(steps[i])];
+    for (int j=STEP_BUCKETS-1, at=0; j>=0; --j){ next[j] = at; at += count[j]; end[j] = at; }
+    for (int j=STEP_BUCKETS-1; j>=0; --j){
+        while (next[j] < end[j]){
+            int i = next[j], b = StepBucket(steps[i]);
+            if (b == j){ ++next[j]; continue; }
+            int k = next[b]++;
+            BallStoreSwap(bs, i, k);
+            int   ts = steps[i]; steps[i] = steps[k]; steps[k] = ts;
+            float td = sdt[i];   sdt[i]   = sdt[k];   sdt[k]   = td;
+            float tr = reach[i]; reach[i] = reach[k]; reach[k] = tr;
+        }
+    }
+    for (int j=0, at=n; j<STEP_BUCKETS; ++j){ bucketEnd[j] = at; at -= count[j]; }
+}
+#endif
+
+// One substep for every ball; balls whose plan is already done advance by zero.
+// Loads are hoisted and every branch is a select, so the loop auto-vectorizes
+// (SSE on native -O3, simd128 under emcc -msimd128).
+static void IntegrateAndBounce(float *restrict x, float *restrict y, float *restrict vx, float *restrict vy,
+                               const float *restrict r, const int *restrict steps, const float *restrict sdt,
+                               int n, int sub, float sw, float sh){
+    for (int i=0;i<n;++i){
+        float d  = sdt[i];
+        float h  = (sub < steps[i]) ? d : 0.0f;
+        float u  = vx[i], v = vy[i], ri = r[i];
+        float px = x[i] + u*h, py = y[i] + v*h;
+        float hx = sw - ri, hy = sh - ri;
+        float cx = (px < ri) ? ri : px; cx = (cx > hx) ? hx : cx;
+        float cy = (py < ri) ? ri : py; cy = (cy > hy) ? hy : cy;
+        vx[i] = (cx != px) ? -u : u;
+        vy[i] = (cy != py) ? -v : v;
+        x[i]  = cx;
+        y[i]  = cy;
+    }
+}
+
+// Scalar twin of the wall clamp in IntegrateAndBounce, for balls moved elsewhere.
+static inline void BounceWalls(float r, float *x, float *y, float *vx, float *vy, float sw, float sh){
+    if (*x < r){ *x = r; *vx = -*vx; } else if (*x > sw - r){ *x = sw - r; *vx = -*vx; }
+    if (*y < r){ *y = r; *vy = -*vy; } else if (*y > sh - r){ *y = sh - r; *vy = -*vy; }
+}
+
+// ----- Swept ball vs. shape (time of impact) -----
+// Moves one ball through dt against its candidate shapes, reflecting at each time
+// of impact. After CCD_MAX_TOI impacts the ball stops at the next contact instead.
+#if SWEPT_CCD
+static void SweepBall(const ShapeCompiled *shapes, const int *cand, int nCand, float r,
+                      float *bx, float *by, float *vx, float *vy, float dt){
+    float x = *bx, y = *by, u = *vx, v = *vy, left = dt;
+    for (int hit=0; left > 0.0f; ++hit){
+        float dx = u*left, dy = v*left, best = 2.0f, nx = 0.0f, ny = 0.0f;
+        float span = sqrtf(dx*dx + dy*dy) + r;
+        const ShapeCompiled *hitK = NULL;
+        for (int c=0;c<nCand;++c){
+            const ShapeCompiled *sk = &shapes[cand[c]];
+            float ox = x - sk->x, oy = y - sk->y, reach = sk->hull + span;
+            if (ox*ox + oy*oy > reach*reach) continue;
+            float t, cx, cy;
+            if (SweepCircleVsShape(sk, r, x, y, dx, dy, &t, &cx, &cy) && t < best){ best = t; nx = cx; ny = cy; hitK = sk; }
+        }
+        if (best > 1.0f) break;
+        if (hit == CCD_MAX_TOI){ left *= best; break; }
+        x += dx*best + nx*SEP_BIAS;
+        y += dy*best + ny*SEP_BIAS;
+        ReflectOffShape(hitK, x, y, nx, ny, &u, &v);
+        left -= left*best;
+    }
+    *bx = x + u*left; *by = y + v*left; *vx = u; *vy = v;
+}
+#endif
+
+// A shape that moved since the last sim step plows through the balls in its
+// path. In the shape's frame the ball travels back along the shape's motion,
+// so the same sweep finds where the leading face met it; the ball is left
+// there, touching the face at the shape's new pose, and batted ahead. A ball
+// already touching the face is carried along. Translation only: spin and
+// pinch are covered by the moving-wall bounce and depenetration.
+static int SweepBallByShape(const ShapeCompiled *k, float r, float *bx, float *by, float *vx, float *vy){
+    const float mx = k->mx, my = k->my;
+    if (k->moved <= r) return 0;   // can't overrun the centre: the resolver's push is enough
+    // Swept hull: the capsule between the old and new centres. Only the
+    // leading half of it can strike; the trailing side moves away.
+    float wx = *bx - k->x + mx, wy = *by - k->y + my;
+    float u = (wx*mx + wy*my) / (k->moved * k->moved);
+    if (u <= 0.0f) return 0;
+    u = (u > 1.0f) ? 1.0f : u;
+    float ex = wx - mx*u, ey = wy - my*u, reach = k->hull + r;
+    if (ex*ex + ey*ey > reach*reach) return 0;
+
+    float qx = *bx + mx, qy = *by + my;   // the ball against the shape's old pose
+    float t, nx, ny;
+    float d0 = CompiledDistanceNormal(k, qx, qy, &nx, &ny);
+    if (d0 < 0.0f) return 0;                                        // was inside already: depenetration's job
+    if (d0 < r){
+        // Touching: carried only if the shape moves into it and overran the
+        // centre; a shallower overlap is the resolver's ordinary push.
+        if (mx*nx + my*ny <= 0.0f || CompiledDistance(k, *bx, *by) >= 0.0f) return 0;
+        t = 0.0f;
+    } else if (!SweepCircleVsShape(k, r, qx, qy, -mx, -my, &t, &nx, &ny)) return 0;
+    *bx = qx - mx*t + nx*SEP_BIAS;
+    *by = qy - my*t + ny*SEP_BIAS;
+    ReflectOffShape(k, *bx, *by, nx, ny, vx, vy);
+    return 1;
+}
+
+// ----- Trapped-ball depenetration -----
+// A ball whose centre ended up inside a shape (usually one dragged over it) is
+// moved out along that shape's distance gradient until it just touches the
+// surface, and turned around if it was heading in. A push can land it in a
+// neighbour or against a wall, so it is repeated up to DEPEN_ITERS times;
+// only a ball still inside after that falls back to a respawn.
+static inline int ShapeGridDeepestAt(const ShapeGrid *g, const ShapeTable *t, float px, float py,
+                                     float *dist, float *nx, float *ny){
+    int it, end, best = -1;
+    ShapeGridCell(g, px, py, &it, &end);
+    for (; it<end; ++it){
+        const ShapeCompiled *k = &t->k[g->items[it]];
+        if (!CompiledPointIn(k, px, py)) continue;
+        float cx, cy, d = CompiledDistanceNormal(k, px, py, &cx, &cy);
+        if (best < 0 || d < *dist){ best = g->items[it]; *dist = d; *nx = cx; *ny = cy; }
+    }
+    return best;
+}
+
+static int DepenetrateBall(const ShapeGrid *g, const ShapeTable *t, float r, float *bx, float *by,
+                           float *vx, float *vy, float sw, float sh){
+    for (int it=0; it<DEPEN_ITERS; ++it){
+        float d = 0.0f, nx = 0.0f, ny = 0.0f;
+        if (ShapeGridDeepestAt(g, t, *bx, *by, &d, &nx, &ny) < 0) return 1;
+        float push = ((it == 0) ? r - d : -d) + SEP_BIAS;   // after the first push, just clear the centre
+        *bx += nx * push; *by += ny * push;
+        float vn = *vx * nx + *vy * ny;
+        if (vn < 0.0f){ *vx -= 2.0f * vn * nx; *vy -= 2.0f * vn * ny; }
+        BounceWalls(r, bx, by, vx, vy, sw, sh);
+    }
+    return !ShapeGridPointInAny(g, t, *bx, *by);
+}
+
+// ----- Ball↔ball collision (spatial hash) -----
+#if BALL_BALL_COLLIDE
+static inline int BallHashBucket(const BallHash *h, int cx, int cy){
+    return (int)(((unsigned)cx * 73856093u) ^ ((unsigned)cy * 19349663u)) & h->mask;
+}
+
+// 0 when the table cannot grow; the hash keeps its old blocks and capacity.
+static int BallHashBuild(BallHash *h, const BallStore *bs, int n){
+    int table = 1; while (table < n*2) table <<= 1;
+    if (table + 1 > h->tableCap){
+        int *cs = (int*)realloc(h->cellStart, sizeof(int) * (table + 1));
+        if (!cs) return 0;
+        h->cellStart = cs; h->tableCap = table + 1;
+    }
+    if (n > h->ballCap){
+        int *o = (int*)realloc(h->order, sizeof(int) * n);
+        if (!o) return 0;
+        h->order = o;
+        int *b = (int*)realloc(h->bucketOf, sizeof(int) * n);
+        if (!b) return 0;
+        h->bucketOf = b;
+        h->ballCap  = n;
+    }
+    h->mask    = table - 1;
+    h->invCell = 1.0f / (BALL_RADIUS_MAX * 2.0f);
+
+    for (int c=0;c<=table;++c) h->cellStart[c] = 0;
+    for (int i=0;i<n;++i){
+        int b = BallHashBucket(h, (int)floorf(bs->x[i] * h->invCell), (int)floorf(bs->y[i] * h->invCell));
+        h->bucketOf[i] = b;
+        h->cellStart[b+1]++;
+    }
+    for (int c=0;c<table;++c) h->cellStart[c+1] += h->cellStart[c];
+    for (int i=0;i<n;++i) h->order[h->cellStart[h->bucketOf[i]]++] = i;
+    for (int c=table;c>0;--c) h->cellStart[c] = h->cellStart[c-1];
+    h->cellStart[0] = 0;
+    return 1;
+}
+
+void BallHashFree(BallHash *h){
+    free(h->cellStart); free(h->order); free(h->bucketOf);
+    *h = (BallHash){0};
+}
+
+// Elastic response with mass ∝ r², so kinetic energy is conserved per contact.
+static inline int ResolveBallVsBall(BallStore *bs, int a, int b){
+    float dx = bs->x[b] - bs->x[a], dy = bs->y[b] - bs->y[a];
+    float rSum = bs->r[a] + bs->r[b];
+    float d2 = dx*dx + dy*dy;
+    if (d2 >= rSum*rSum || d2 <= 1e-12f) return 0;
+
+    float d  = sqrtf(d2);
+    float nx = dx/d, ny = dy/d;
+    float ma = bs->r[a]*bs->r[a], mb = bs->r[b]*bs->r[b];
+    float inv = 1.0f / (ma + mb);
+
+    float pen = rSum - d;
+    bs->x[a] -= nx * pen * (mb*inv); bs->y[a] -= ny * pen * (mb*inv);
+    bs->x[b] += nx * pen * (ma*inv); bs->y[b] += ny * pen * (ma*inv);
+
+    float vrel = (bs->vx[b] - bs->vx[a])*nx + (bs->vy[b] - bs->vy[a])*ny;
+    if (vrel < 0.0f){
+        float ja = 2.0f * mb * inv * vrel;
+        float jb = 2.0f * ma * inv * vrel;
+        bs->vx[a] += ja*nx; bs->vy[a] += ja*ny;
+        bs->vx[b] -= jb*nx; bs->vy[b] -= jb*ny;
+    }
+    return 1;
+}
+
+float BallsKineticEnergy(const BallStore *bs, int n){
+    double e = 0.0;
+    for (int i=0;i<n;++i) e += 0.5 * (double)(bs->r[i]*bs->r[i]) * (double)(bs->vx[i]*bs->vx[i] + bs->vy[i]*bs->vy[i]);
+    return (float)e;
+}
+
+int CollideBallsPairwise(BallHash *h, BallStore *bs, int n){
+    if (!BallHashBuild(h, bs, n)) return 0;   // out of memory: no ball↔ball contacts this frame
+    int contacts = 0;
+    for (int i=0;i<n;++i){
+        int cx = (int)floorf(bs->x[i] * h->invCell), cy = (int)floorf(bs->y[i] * h->invCell);
+        int seen[9], nSeen = 0;
+        for (int oy=-1;oy<=1;++oy){
+            for (int ox=-1;ox<=1;++ox){
+                int bucket = BallHashBucket(h, cx+ox, cy+oy);
+                int dup = 0;
+                for (int s=0;s<nSeen;++s) if (seen[s] == bucket){ dup = 1; break; }
+                if (dup) continue;
+                seen[nSeen++] = bucket;
+                for (int it=h->cellStart[bucket]; it<h->cellStart[bucket+1]; ++it){
+                    int j = h->order[it];
+                    if (j <= i) continue;
+                    contacts += ResolveBallVsBall(bs, i, j);
+                }
+            }
+        }
+    }
+    return contacts;
+}
+#endif
+
+// ----- Parallel ball sim (slices + worker pool) -----
+void SimSliceInit(SimSlice *s){
+    *s = (SimSlice){0};
+}
+
+void SimSliceFree(SimSlice *s){
+    free(s->contactIdx); free(s->candStart); free(s->candItems);
+    free(s->shapeStart); free(s->shapeFill); free(s->shapeBalls); free(s->respawn);
+    *s = (SimSlice){0};
+}
+
+// Grows the slice's per-ball and per-shape lists; 0 when one cannot grow
+// (the slice keeps its old blocks and capacities).
+static int SimSliceReserve(SimSlice *s, int nBalls, int nShapes){
+    if (nShapes > s->shapeCap){
+        int *st = (int*)realloc(s->shapeStart, sizeof(int) * (nShapes + 1));
+        if (!st) return 0;
+        s->shapeStart = st;
+        int *sf = (int*)realloc(s->shapeFill, sizeof(int) * nShapes);
+        if (!sf) return 0;
+        s->shapeFill = sf;
+        s->shapeCap  = nShapes;
+    }
+    if (nBalls <= s->ballCap) return 1;
+    int **lists[3] = { &s->contactIdx, &s->candStart, &s->respawn };
+    for (int l=0;l<3;++l){
+        int *p = (int*)realloc(*lists[l], sizeof(int) * (nBalls + 1));   // candStart has the +1
+        if (!p) return 0;
+        *lists[l] = p;
+    }
+    s->ballCap = nBalls;
+    return 1;
+}
+
+// Job 1: snapshot positions for interpolation and plan substeps for the slice;
+// the step's max reach is reduced afterwards.
+static void SimPlanSlice(void *ctx, int si){
+    SimFrame *f = (SimFrame*)ctx;
+    SimSlice *s = &f->slices[si];
+    BallStore *b = f->balls;
+    const int o = s->begin;
+    memcpy(b->px + o, b->x + o, sizeof(float) * (s->end - o));
+    memcpy(b->py + o, b->y + o, sizeof(float) * (s->end - o));
+    s->maxReach = PlanBallSubsteps(b->vx + o, b->vy + o, b->r + o, f->steps + o, f->sdt + o, f->reach + o,
+                                   s->end - o, f->dt, (SWEPT_CCD && !SUBSTEP_BUCKETS) ? 1 : MAX_SUBSTEPS);
+}
+
+// Balls of the slice still moving in substep `sub`: a prefix of [o, o+n).
+static inline int SubstepActive(const SimFrame *f, int o, int n, int sub){
+#if SUBSTEP_BUCKETS
+    int active = f->bucketEnd[StepBucket(sub + 1)] - o;
+    return (active < 0) ? 0 : (active > n) ? n : active;
+#else
+    (void)f; (void)o; (void)sub;
+    return n;
+#endif
+}
+
+// Discrete ball vs. shape pass over the slice's contact balls for substep `sub`.
+static void SimNarrowphase(SimFrame *f, SimSlice *s, int sub){
+    BallStore *b = f->balls;
+    const ShapeCompiled *shapes = f->tab->k;
+#if SIMD_NARROWPHASE
+    // Shape-major: four balls at a time against one shape. Balls do not
+    // interact here and shapes are walked in ascending order, so every
+    // ball sees its candidates in the same order as the scalar path.
+    for (int k=0; k<f->tab->n; ++k){
+        const ShapeCompiled *sk = &shapes[k];
+        if (sk->sdf || sk->poly){
+            // Silhouettes and polygons have no lane kernel: same balls, one at a time.
+            for (int c=s->shapeStart[k]; c<s->shapeStart[k+1]; ++c){
+                int i = s->shapeBalls[c];
+                if (sub >= f->steps[i]) continue;
+                float dx = b->x[i] - sk->x, dy = b->y[i] - sk->y;
+                float reach = sk->hull + b->r[i];
+                if (dx*dx + dy*dy <= reach*reach)
+                    ResolveCircleVsShape(sk, b->r[i], &b->x[i], &b->y[i], &b->vx[i], &b->vy[i]);
+            }
+            continue;
+        }
+        int lane[SIMD_LANES], nl = 0;
+        for (int c=s->shapeStart[k]; c<=s->shapeStart[k+1]; ++c){
+            if (c < s->shapeStart[k+1]){
+                int i = s->shapeBalls[c];
+                if (sub >= f->steps[i]) continue;
+                lane[nl++] = i;
+                if (nl < SIMD_LANES) continue;
+            }
+            if (nl == 0) break;
+
+            float lx[SIMD_LANES]={0}, ly[SIMD_LANES]={0}, lvx[SIMD_LANES]={0}, lvy[SIMD_LANES]={0}, lr[SIMD_LANES]={0};
+            for (int l=0;l<nl;++l){
+                int i = lane[l];
+                lx[l] = b->x[i]; ly[l] = b->y[i]; lvx[l] = b->vx[i]; lvy[l] = b->vy[i]; lr[l] = b->r[i];
+            }
+            BallLanes bl = { fv_load(lx), fv_load(ly), fv_load(lvx), fv_load(lvy), fv_load(lr) };
+            ResolveCircleVsShapeLanes(sk, &bl, LaneMask((1u << nl) - 1u));
+            fv_store(lx, bl.x); fv_store(ly, bl.y); fv_store(lvx, bl.vx); fv_store(lvy, bl.vy);
+            for (int l=0;l<nl;++l){
+                int i = lane[l];
+                b->x[i] = lx[l]; b->y[i] = ly[l]; b->vx[i] = lvx[l]; b->vy[i] = lvy[l];
+            }
+            nl = 0;
+        }
+    }
+#else
+    for (int ci=0; ci<s->nContact; ++ci){
+        int i = s->contactIdx[ci];
+        if (sub >= f->steps[i]) continue;
+        for (int c=s->candStart[ci]; c<s->candStart[ci+1]; ++c){
+            const ShapeCompiled *sk = &shapes[s->candItems[c]];
+            float dx = b->x[i] - sk->x, dy = b->y[i] - sk->y;
+            float reach = sk->hull + b->r[i];
+            if (dx*dx + dy*dy <= reach*reach){
+                ResolveCircleVsShape(sk, b->r[i], &b->x[i], &b->y[i], &b->vx[i], &b->vy[i]);
+            }
+        }
+    }
+#endif
+}
+
+// Job 2: broadphase, substeps (or sweeps) and trap check for the slice.
+static void SimStepSlice(void *ctx, int si){
+    SimFrame *f = (SimFrame*)ctx;
+    SimSlice *s = &f->slices[si];
+    BallStore *b = f->balls;
+    const ShapeCompiled *shapes = f->tab->k;
+    const int o = s->begin, n = s->end - s->begin;
+
+    // Broadphase once per frame: keep only balls whose reach touches a shape
+    // hull, with their candidate shapes packed back to back.
+    int nContact = 0, candCount = 0;
+    for (int i=o;i<s->end;++i){
+        int it, end; ShapeGridCell(f->grid, b->x[i], b->y[i], &it, &end);
+        if (it == end) continue;
+        if (candCount + (end - it) > s->candCap){
+            const int cap = (candCount + (end - it)) * 2;
+            int *ci = (int*)realloc(s->candItems, sizeof(int) * cap);
+            if (ci) s->candItems = ci;
+            int *sb = (int*)realloc(s->shapeBalls, sizeof(int) * cap);
+            if (sb) s->shapeBalls = sb;
+            // Out of memory: the ball sits this step out instead of passing through shapes
+            if (!ci || !sb){ f->steps[i] = 0; continue; }
+            s->candCap = cap;
+        }
+        int nc = 0;
+        for (; it<end; ++it){
+            const ShapeCompiled *sk = &shapes[f->grid->items[it]];
+            float dx = b->x[i] - sk->x, dy = b->y[i] - sk->y;
+            float reach = sk->hull + f->reach[i] + (f->sweepShapes ? sk->moved : 0.0f);
+            if (dx*dx + dy*dy <= reach*reach) s->candItems[candCount + nc++] = f->grid->items[it];
+        }
+        if (nc == 0) continue;
+        s->contactIdx[nContact] = i;
+        s->candStart[nContact]  = candCount;
+        candCount += nc;
+        ++nContact;
+    }
+    s->candStart[nContact] = candCount;
+    s->nContact = nContact;
+#if KINEMATIC_SHAPES
+    s->nPlowed = 0;
+    if (f->sweepShapes){
+        for (int ci=0; ci<nContact; ++ci){
+            int i = s->contactIdx[ci];
+            int plowed = 0;
+            for (int c=s->candStart[ci]; c<s->candStart[ci+1]; ++c)
+                plowed |= SweepBallByShape(&shapes[s->candItems[c]], b->r[i], &b->x[i], &b->y[i], &b->vx[i], &b->vy[i]);
+            if (!plowed) continue;
+            b->px[i] = b->x[i]; b->py[i] = b->y[i];   // moves with the shape, not through it
+            ++s->nPlowed;
+        }
+    }
+#endif
+#if SIMD_NARROWPHASE
+    // Transpose contact lists to per-shape ball lists (counting sort).
+    for (int k=0; k<=f->tab->n; ++k) s->shapeStart[k] = 0;
+    for (int c=0; c<candCount; ++c) ++s->shapeStart[s->candItems[c] + 1];
+    for (int k=0; k<f->tab->n; ++k){ s->shapeStart[k+1] += s->shapeStart[k]; s->shapeFill[k] = s->shapeStart[k]; }
+    for (int ci=0; ci<nContact; ++ci){
+        for (int c=s->candStart[ci]; c<s->candStart[ci+1]; ++c){
+            s->shapeBalls[s->shapeFill[s->candItems[c]]++] = s->contactIdx[ci];
+        }
+    }
+#endif
+
+#if SWEPT_CCD
+    // Park contact balls for the wall kernel (a negated plan never moves),
+    // run the free balls through their buckets, then sweep each contact ball
+    // in steps[i] pieces: a fast ball gets CCD_MAX_TOI impacts per piece, not
+    // per step. One discrete pass settles resting and leftover overlaps.
+    for (int ci=0; ci<nContact; ++ci) f->steps[s->contactIdx[ci]] = -f->steps[s->contactIdx[ci]];
+    for (int sub=0; sub<(SUBSTEP_BUCKETS ? MAX_SUBSTEPS : 1); ++sub){
+        int active = SubstepActive(f, o, n, sub);
+        if (active == 0) break;
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        double subT0 = GetTime();
+#endif
+        IntegrateAndBounce(b->x + o, b->y + o, b->vx + o, b->vy + o, b->r + o, f->steps + o, f->sdt + o,
+                           active, sub, f->sw, f->sh);
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        s->bucketMs[StepBucket(sub + 1)] += (GetTime() - subT0) * 1000.0;
+#endif
+    }
+#if SHOW_STATS || SIM_BENCH_FRAMES
+    // Contact balls come in index order, so bucket by bucket: one clock read per bucket
+    double sweepT0 = GetTime();
+    int    sweepBucket = -1;
+#endif
+    for (int ci=0; ci<nContact; ++ci){
+        int i = s->contactIdx[ci], k = -f->steps[i];
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        if (StepBucket(k) != sweepBucket){
+            double t = GetTime();
+            if (sweepBucket >= 0) s->bucketMs[sweepBucket] += (t - sweepT0) * 1000.0;
+            sweepT0 = t; sweepBucket = StepBucket(k);
+        }
+#endif
+        for (int piece=0; piece<k; ++piece){
+            SweepBall(shapes, &s->candItems[s->candStart[ci]], s->candStart[ci+1] - s->candStart[ci], b->r[i],
+                      &b->x[i], &b->y[i], &b->vx[i], &b->vy[i], f->sdt[i]);
+            BounceWalls(b->r[i], &b->x[i], &b->y[i], &b->vx[i], &b->vy[i], f->sw, f->sh);
+        }
+        f->steps[i] = 1;
+    }
+#if SHOW_STATS || SIM_BENCH_FRAMES
+    if (sweepBucket >= 0) s->bucketMs[sweepBucket] += (GetTime() - sweepT0) * 1000.0;
+#endif
+    SimNarrowphase(f, s, 0);
+#else
+    for (int sub=0; sub<MAX_SUBSTEPS; ++sub){
+        // Only a prefix of the slice still moves; the rest has finished its plan.
+        int active = SubstepActive(f, o, n, sub);
+        if (active == 0) break;
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        double subT0 = GetTime();
+#endif
+        IntegrateAndBounce(b->x + o, b->y + o, b->vx + o, b->vy + o, b->r + o, f->steps + o, f->sdt + o,
+                           active, sub, f->sw, f->sh);
+        SimNarrowphase(f, s, sub);
+#if SHOW_STATS || SIM_BENCH_FRAMES
+        s->bucketMs[StepBucket(sub + 1)] += (GetTime() - subT0) * 1000.0;
+#endif
+    }
+#endif
+
+    // Only balls near a shape can have ended up inside one
+    s->nTrapped = 0; s->nRespawn = 0;
+    for (int ci=0; ci<nContact; ++ci){
+        int i = s->contactIdx[ci];
+        if (!ShapeGridPointInAny(f->grid, f->tab, b->x[i], b->y[i])) continue;
+        ++s->nTrapped;
+#if DEPENETRATE
+        if (DepenetrateBall(f->grid, f->tab, b->r[i], &b->x[i], &b->y[i], &b->vx[i], &b->vy[i], f->sw, f->sh)) continue;
+#endif
+        s->respawn[s->nRespawn++] = i;
+    }
+
+#if SHOW_STATS || SIM_BENCH_FRAMES
+    // Tunnel count for the stats: the centre's straight start->end path crosses
+    // a candidate shape while neither end is inside it.
+    s->nTunnel = 0;
+    for (int ci=0; ci<nContact; ++ci){
+        int i = s->contactIdx[ci];
+        float x0 = b->px[i], y0 = b->py[i], x1 = b->x[i], y1 = b->y[i];
+        for (int c=s->candStart[ci]; c<s->candStart[ci+1]; ++c){
+            const ShapeCompiled *sk = &shapes[s->candItems[c]];
+            float t, nx, ny;
+            if (!CompiledPointIn(sk, x0, y0) && !CompiledPointIn(sk, x1, y1) &&
+                SweepCircleVsShape(sk, 0.0f, x0, y0, x1 - x0, y1 - y0, &t, &nx, &ny)){ ++s->nTunnel; break; }
+        }
+    }
+#endif
+}
+
+// Slices for this frame: one per thread, but never thinner than SIM_MIN_SLICE.
+static int SimSliceCount(int nBalls){
+    int n = nBalls / SIM_MIN_SLICE;
+    if (n > SimPoolThreads()) n = SimPoolThreads();
+    return (n < 1) ? 1 : n;
+}
+
+// One sim step over the awake balls: plan, substep buckets, broadphase grid
+// sized to this step's reach, the step itself, then the serial respawn of
+// whatever the slices could not push out. f->grid is set to grid; the
+// caller fills the rest of the frame. Returns the slice count used, for
+// reading the per-slice stats; 0 when the slices could not grow and the
+// step was skipped.
+int SimStep(SimFrame *f, ShapeGrid *grid, SpawnMap *spawn){
+    BallStore *b = f->balls;
+    SimSlice *slices = f->slices;
+    const int nBalls  = b->awake;
+    const int nSlices = SimSliceCount(nBalls);
+    for (int si=0; si<nSlices; ++si){
+        slices[si].begin = (int)((long long)nBalls * si / nSlices);
+        slices[si].end   = (int)((long long)nBalls * (si + 1) / nSlices);
+        if (!SimSliceReserve(&slices[si], slices[si].end - slices[si].begin, f->tab->n)){
+            TraceLog(LOG_WARNING, "SIM: out of memory, step skipped");
+            return 0;
+        }
+    }
+    f->grid = grid;
+
+    SimRun(SimPlanSlice, f, nSlices);
+#if SUBSTEP_BUCKETS
+    BallsSortBySteps(b, f->steps, f->sdt, f->reach, nBalls, f->bucketEnd);
+#endif
+    float maxReach = 0.0f;
+    for (int si=0; si<nSlices; ++si) if (slices[si].maxReach > maxReach) maxReach = slices[si].maxReach;
+    ShapeGridBuild(grid, f->tab, (int)f->sw, (int)f->sh, GRID_CELL_PX, maxReach);
+
+    SimRun(SimStepSlice, f, nSlices);
+    for (int si=0; si<nSlices; ++si){
+        for (int q=0; q<slices[si].nRespawn; ++q){
+            int i = slices[si].respawn[q];
+            RespawnBallOutsideAllShapes(b, i, f->tab, spawn, f->sw, f->sh);
+            b->px[i] = b->x[i]; b->py[i] = b->y[i];   // no smear across the jump
+        }
+    }
+    return nSlices;
+}
@@ -0,0 +1,156 @@
+// sim.h — ball store, free-space spawning, sleep, compact store and the parallel ball sim step
+#ifndef SIM_H
+#define SIM_H
+#include "shapes.h"
+
+// ----- Ball store -----
+// Balls are stored as parallel arrays: the sim kernels only stream the hot
+// x/y/vx/vy/r lanes, colors are touched by the draw pass alone.
+typedef struct {
+    int    count, cap;
+    int    awake;           // [0, awake) are simulated, [awake, count) are asleep
+    float *x, *y;
+    float *px, *py;         // position one sim step ago, for render interpolation
+    float *vx, *vy;
+    float *r;
+    Color *col;
+} BallStore;
+
+int  BallStoreInit(BallStore *bs, int cap);
+void BallStoreFree(BallStore *bs);
+int  BallStoreReserve(BallStore *bs, int cap);
+
+// ----- Free-space spawn map -----
+// Coarse clearance map of the window: each cell stores how far (whole px) any
+// point in it is from the nearest wall, or shape minus SPAWN_MARGIN, capped at
+// SPAWN_CLEAR_CAP. Cells are kept sorted by clearance, descending, so the cells
+// that fit radius r are a prefix and a spawn is one random index. The map is
+// marked stale when the compiled shapes or window change and rebuilt lazily on
+// the next spawn.
+#define SPAWN_CLEAR_CAP 32   // > BALL_RADIUS_MAX; larger clearances are not told apart
+
+typedef struct {
+    int            cols, rows, sw, sh;
+    unsigned char *clear;       // cols*rows
+    int           *cells;       // cell indices, clearance descending
+    int            cellCap;
+    int            atLeast[SPAWN_CLEAR_CAP + 2];   // cells with clearance >= c
+    ShapeCompiled *last;        // shapes the map was built from; poly points into lastPolys
+    PolyCompiled  *lastPolys;   // the map's own copy of their outlines
+    int            lastN, lastCap, lastPolyCap, valid, stale;
+} SpawnMap;
+
+void SpawnMapUpdate(SpawnMap *m, const ShapeTable *t, int sw, int sh);
+void SpawnMapFree(SpawnMap *m);
+void RespawnBallOutsideAllShapes(BallStore *bs, int bi, const ShapeTable *t, SpawnMap *map, float sw, float sh);
+
+// ----- Ball sleep -----
+void BallsUpdateSleep(BallStore *bs);
+void BallsWakeNearMovedShapes(BallStore *bs, const ShapeTable *prev, const ShapeTable *cur);
+int  BallsSetCount(BallStore *bs, int n, const ShapeTable *t, SpawnMap *map, float sw, float sh);
+
+#if COMPACT_BALLS
+// ----- Compact ball store -----
+// 10 bytes per ball instead of 32: position as a 0.16 fraction of the window
+// it was packed against, velocity as IEEE half floats, radius and colour as
+// byte indices into tables built once from the radius range and
+// GRADIENT_STOPS. The sim never sees this format: each pass unpacks up to
+// COMPACT_CHUNK balls into a float BallStore, runs the usual kernels on it
+// and packs them back. There is no previous position; drawing blends back
+// along the velocity instead.
+typedef struct {
+    uint16_t x, y;     // fraction of sw/sh, 0..65535 (~1/64 px at 1024 wide: a ball under ~1 px/s stalls)
+    uint16_t vx, vy;   // half floats, px/s
+    uint8_t  r;        // index into gBallRadiusLut
+    uint8_t  col;      // index into gBallPaletteLut
+} BallPacked;
+
+typedef struct {
+    BallPacked *b;
+    int         count, cap;
+    float       sw, sh;   // window size the positions are fractions of
+} BallPackedStore;
+
+extern float gBallRadiusLut[256];
+extern Color gBallPaletteLut[256];
+
+void BallLutsInit(void);
+int  BallPackedReserve(BallPackedStore *p, int cap);
+void BallPackedFree(BallPackedStore *p);
+void BallsUnpack(const BallPackedStore *p, int begin, int n, BallStore *w);
+void BallsPack(BallPackedStore *p, int begin, const BallStore *w, float sw, float sh);
+int  BallsPackedSetCount(BallPackedStore *p, BallStore *w, int n, const ShapeTable *t, SpawnMap *map,
+                        float sw, float sh);
+
+static inline float FloatFromHalf(uint16_t h){
+    uint32_t e = (h >> 10) & 0x1fu;
+    uint32_t u = ((uint32_t)(h & 0x8000u) << 16) | (e ? (((e + 112u) << 23) | ((uint32_t)(h & 0x3ffu) << 13)) : 0u);
+    float f; memcpy(&f, &u, sizeof(f));
+    return f;
+}
+#endif
+
+#if DETERMINISTIC
+uint64_t SimStateHash(const BallStore *bs, const Shape *shapes, int nShapes);
+#endif
+
+// ----- Ball↔ball collision (spatial hash) -----
+// Cell side is the largest possible contact distance, so any touching pair
+// lives in the same or an adjacent cell. The table is rebuilt every frame by
+// counting sort over hashed cell ids.
+#if BALL_BALL_COLLIDE
+typedef struct {
+    float invCell;
+    int   mask;         // tableSize-1 (power of two)
+    int  *cellStart;    // tableSize+1
+    int  *order;        // ball indices grouped by bucket
+    int  *bucketOf;     // per-ball bucket
+    int   tableCap, ballCap;
+} BallHash;
+
+typedef struct { int contacts; double ms; float keBefore, keAfter; } BallBallStats;
+
+void  BallHashFree(BallHash *h);
+float BallsKineticEnergy(const BallStore *bs, int n);
+int   CollideBallsPairwise(BallHash *h, BallStore *bs, int n);
+#endif
+
+#define STEP_BUCKETS 4   // substep buckets: 1, 2, 4 and 8 steps
+
+// ----- Parallel ball sim (slices + worker pool) -----
+// The ball range is cut into contiguous slices, one per worker. Shapes and the
+// grid are read-only during the ball phase, so slices share them without locks.
+// Trapped balls are pushed out in the slice; the few that cannot be are queued
+// and respawned serially afterwards, in ball order, since
+// RespawnBallOutsideAllShapes draws from the sim RNG.
+typedef struct {
+    int    begin, end;      // ball range
+    float  maxReach;
+    int   *contactIdx;      // balls with shape candidates
+    int   *candStart;       // per contact ball, into candItems
+    int   *candItems;
+    int   *shapeStart;      // per shape, into shapeBalls (candItems transposed)
+    int   *shapeFill;
+    int   *shapeBalls;
+    int   *respawn;         // trapped balls left for respawn after the parallel phase
+    int    nContact, nTrapped, nRespawn, nTunnel, nPlowed, ballCap, candCap, shapeCap;
+    double bucketMs[STEP_BUCKETS];   // stats: substep time that exists because of each bucket
+} SimSlice;
+
+typedef struct {
+    BallStore       *balls;
+    int             *steps;
+    float           *sdt, *reach;
+    const ShapeTable *tab;
+    const ShapeGrid *grid;
+    float            dt, sw, sh;
+    SimSlice        *slices;
+    int              bucketEnd[STEP_BUCKETS];   // balls with at least 2^j steps are [0, bucketEnd[j])
+    int              sweepShapes;               // first step since the shapes moved: plow balls out of their path
+} SimFrame;
+
+void SimSliceInit(SimSlice *s);
+void SimSliceFree(SimSlice *s);
+int  SimStep(SimFrame *f, ShapeGrid *grid, SpawnMap *spawn);
+
+#endif
@@ -0,0 +1,240 @@
+// simd.h — 4/8-lane float SIMD and the batched ball vs. shape kernels built on it
+#ifndef SIMD_H
+#define SIMD_H
+#include "shapes.h"
+
+#if defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+#elif defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE4_1__)
+    #include <smmintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// ----- Float SIMD (AVX 8 lanes / wasm simd128 / SSE / scalar fallback, 4 lanes) -----
+// Masks are all-ones / all-zeros lanes of the same type, as in SSE. Callers
+// gather SIMD_LANES balls at a time; everything else is width-agnostic.
+#if defined(__AVX__)
+#define SIMD_LANES 8
+typedef __m256 fv;
+static inline fv fv_set1(float a){ return _mm256_set1_ps(a); }
+static inline fv fv_load(const float *p){ return _mm256_loadu_ps(p); }
+static inline void fv_store(float *p, fv a){ _mm256_storeu_ps(p, a); }
+static inline fv fv_add(fv a, fv b){ return _mm256_add_ps(a, b); }
+static inline fv fv_sub(fv a, fv b){ return _mm256_sub_ps(a, b); }
+static inline fv fv_mul(fv a, fv b){ return _mm256_mul_ps(a, b); }
+static inline fv fv_div(fv a, fv b){ return _mm256_div_ps(a, b); }
+static inline fv fv_sqrt(fv a){ return _mm256_sqrt_ps(a); }
+static inline fv fv_min(fv a, fv b){ return _mm256_min_ps(a, b); }
+static inline fv fv_max(fv a, fv b){ return _mm256_max_ps(a, b); }
+static inline fv fv_abs(fv a){ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline fv fv_lt(fv a, fv b){ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline fv fv_le(fv a, fv b){ return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline fv fv_gt(fv a, fv b){ return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline fv fv_and(fv a, fv b){ return _mm256_and_ps(a, b); }
+static inline fv fv_sel(fv m, fv a, fv b){ return _mm256_blendv_ps(b, a, m); }
+static inline int fv_any(fv m){ return _mm256_movemask_ps(m) != 0; }
+#elif defined(__wasm_simd128__)
+#define SIMD_LANES 4
+typedef v128_t fv;
+static inline fv fv_set1(float a){ return wasm_f32x4_splat(a); }
+static inline fv fv_load(const float *p){ return wasm_v128_load(p); }
+static inline void fv_store(float *p, fv a){ wasm_v128_store(p, a); }
+static inline fv fv_add(fv a, fv b){ return wasm_f32x4_add(a, b); }
+static inline fv fv_sub(fv a, fv b){ return wasm_f32x4_sub(a, b); }
+static inline fv fv_mul(fv a, fv b){ return wasm_f32x4_mul(a, b); }
+static inline fv fv_div(fv a, fv b){ return wasm_f32x4_div(a, b); }
+static inline fv fv_sqrt(fv a){ return wasm_f32x4_sqrt(a); }
+static inline fv fv_min(fv a, fv b){ return wasm_f32x4_pmin(a, b); }
+static inline fv fv_max(fv a, fv b){ return wasm_f32x4_pmax(a, b); }
+static inline fv fv_abs(fv a){ return wasm_f32x4_abs(a); }
+static inline fv fv_lt(fv a, fv b){ return wasm_f32x4_lt(a, b); }
+static inline fv fv_le(fv a, fv b){ return wasm_f32x4_le(a, b); }
+static inline fv fv_gt(fv a, fv b){ return wasm_f32x4_gt(a, b); }
+static inline fv fv_and(fv a, fv b){ return wasm_v128_and(a, b); }
+static inline fv fv_sel(fv m, fv a, fv b){ return wasm_v128_bitselect(a, b, m); }
+static inline int fv_any(fv m){ return wasm_v128_any_true(m); }
+#elif defined(__SSE2__)
+#define SIMD_LANES 4
+typedef __m128 fv;
+static inline fv fv_set1(float a){ return _mm_set1_ps(a); }
+static inline fv fv_load(const float *p){ return _mm_loadu_ps(p); }
+static inline void fv_store(float *p, fv a){ _mm_storeu_ps(p, a); }
+static inline fv fv_add(fv a, fv b){ return _mm_add_ps(a, b); }
+static inline fv fv_sub(fv a, fv b){ return _mm_sub_ps(a, b); }
+static inline fv fv_mul(fv a, fv b){ return _mm_mul_ps(a, b); }
+static inline fv fv_div(fv a, fv b){ return _mm_div_ps(a, b); }
+static inline fv fv_sqrt(fv a){ return _mm_sqrt_ps(a); }
+static inline fv fv_min(fv a, fv b){ return _mm_min_ps(a, b); }
+static inline fv fv_max(fv a, fv b){ return _mm_max_ps(a, b); }
+static inline fv fv_abs(fv a){ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline fv fv_lt(fv a, fv b){ return _mm_cmplt_ps(a, b); }
+static inline fv fv_le(fv a, fv b){ return _mm_cmple_ps(a, b); }
+static inline fv fv_gt(fv a, fv b){ return _mm_cmpgt_ps(a, b); }
+static inline fv fv_and(fv a, fv b){ return _mm_and_ps(a, b); }
+#if defined(__SSE4_1__)
+static inline fv fv_sel(fv m, fv a, fv b){ return _mm_blendv_ps(b, a, m); }
+#else
+static inline fv fv_sel(fv m, fv a, fv b){ return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#endif
+static inline int fv_any(fv m){ return _mm_movemask_ps(m) != 0; }
+#else
+#define SIMD_LANES 4
+typedef union { float f[SIMD_LANES]; unsigned u[SIMD_LANES]; } fv;
+#define FV_MAP(expr) fv o; for (int l=0;l<SIMD_LANES;++l){ expr; } return o
+#define FV_MASK(c)   (c) ? 0xFFFFFFFFu : 0u
+static inline fv fv_set1(float a){ FV_MAP(o.f[l] = a); }
+static inline fv fv_load(const float *p){ FV_MAP(o.f[l] = p[l]); }
+static inline void fv_store(float *p, fv a){ for (int l=0;l<SIMD_LANES;++l) p[l] = a.f[l]; }
+static inline fv fv_add(fv a, fv b){ FV_MAP(o.f[l] = a.f[l] + b.f[l]); }
+static inline fv fv_sub(fv a, fv b){ FV_MAP(o.f[l] = a.f[l] - b.f[l]); }
+static inline fv fv_mul(fv a, fv b){ FV_MAP(o.f[l] = a.f[l] * b.f[l]); }
+static inline fv fv_div(fv a, fv b){ FV_MAP(o.f[l] = a.f[l] / b.f[l]); }
+static inline fv fv_sqrt(fv a){ FV_MAP(o.f[l] = sqrtf(a.f[l])); }
+static inline fv fv_min(fv a, fv b){ FV_MAP(o.f[l] = (a.f[l] < b.f[l]) ? a.f[l] : b.f[l]); }
+static inline fv fv_max(fv a, fv b){ FV_MAP(o.f[l] = (a.f[l] > b.f[l]) ? a.f[l] : b.f[l]); }
+static inline fv fv_abs(fv a){ FV_MAP(o.f[l] = fabsf(a.f[l])); }
+static inline fv fv_lt(fv a, fv b){ FV_MAP(o.u[l] = FV_MASK(a.f[l] <  b.f[l])); }
+static inline fv fv_le(fv a, fv b){ FV_MAP(o.u[l] = FV_MASK(a.f[l] <= b.f[l])); }
+static inline fv fv_gt(fv a, fv b){ FV_MAP(o.u[l] = FV_MASK(a.f[l] >  b.f[l])); }
+static inline fv fv_and(fv a, fv b){ FV_MAP(o.u[l] = a.u[l] & b.u[l]); }
+static inline fv fv_sel(fv m, fv a, fv b){ FV_MAP(o.u[l] = (a.u[l] & m.u[l]) | (b.u[l] & ~m.u[l])); }
+static inline int fv_any(fv m){ return (m.u[0] | m.u[1] | m.u[2] | m.u[3]) != 0; }
+#undef FV_MASK
+#endif
+
+// ----- Batched ball vs. shape collision (SIMD_LANES lanes) -----
+// Same math and operation order as the scalar resolvers above; every branch
+// becomes a lane mask, so results match the scalar path lane for lane.
+typedef struct { fv x, y, vx, vy, r; } BallLanes;
+
+// Lane mask from the low SIMD_LANES bits of `bits` (bit l -> lane l).
+static inline fv LaneMask(unsigned bits){
+    union { unsigned u; float f; } m[SIMD_LANES];
+    float f[SIMD_LANES];
+    for (int l=0;l<SIMD_LANES;++l){ m[l].u = ((bits >> l) & 1u) ? 0xFFFFFFFFu : 0u; f[l] = m[l].f; }
+    return fv_load(f);
+}
+
+static inline void ReflectLanes(fv *vx, fv *vy, fv nx, fv ny){
+    fv d  = fv_add(fv_mul(*vx, nx), fv_mul(*vy, ny));
+    fv d2 = fv_mul(fv_set1(2.0f), d);
+    *vx = fv_sub(*vx, fv_mul(d2, nx));
+    *vy = fv_sub(*vy, fv_mul(d2, ny));
+}
+
+// ReflectOffShape for all lanes at positions (x,y); lanes outside `hit` are
+// left untouched by the caller's select.
+static inline void ReflectOffShapeLanes(const ShapeCompiled *k, fv x, fv y, fv *vx, fv *vy, fv nx, fv ny){
+#if KINEMATIC_SHAPES
+    fv ox = fv_sub(x, fv_set1(k->x)), oy = fv_sub(y, fv_set1(k->y));
+    fv w = fv_set1(k->w), g = fv_set1(k->grow);
+    fv sx = fv_add(fv_sub(fv_set1(k->vx), fv_mul(w, oy)), fv_mul(g, ox));
+    fv sy = fv_add(fv_add(fv_set1(k->vy), fv_mul(w, ox)), fv_mul(g, oy));
+    fv vn = fv_add(fv_mul(fv_sub(*vx, sx), nx), fv_mul(fv_sub(*vy, sy), ny));
+    fv in = fv_lt(vn, fv_set1(0.0f));
+    if (!fv_any(in)) return;
+    fv vn2 = fv_mul(fv_set1(2.0f), vn);
+    fv ux = fv_sub(*vx, fv_mul(vn2, nx)), uy = fv_sub(*vy, fv_mul(vn2, ny));
+    fv lim2 = fv_add(fv_mul(*vx, *vx), fv_mul(*vy, *vy)), u2 = fv_add(fv_mul(ux, ux), fv_mul(uy, uy));
+    lim2 = fv_max(lim2, fv_set1(KICK_MAX_SPEED*KICK_MAX_SPEED));
+    fv over = fv_gt(u2, lim2);
+    if (fv_any(fv_and(in, over))){
+        fv sc = fv_sel(over, fv_sqrt(fv_div(lim2, u2)), fv_set1(1.0f));
+        ux = fv_sel(over, fv_mul(ux, sc), ux); uy = fv_sel(over, fv_mul(uy, sc), uy);
+    }
+    *vx = fv_sel(in, ux, *vx); *vy = fv_sel(in, uy, *vy);
+#else
+    (void)k; (void)x; (void)y;
+    ReflectLanes(vx, vy, nx, ny);
+#endif
+}
+
+// Fallback normal when the contact is degenerate: dominant velocity axis.
+static inline void AxisNormalLanes(fv vx, fv vy, fv *nx, fv *ny){
+    const fv zero = fv_set1(0.0f), one = fv_set1(1.0f), mone = fv_set1(-1.0f);
+    fv useX = fv_gt(fv_abs(vx), fv_abs(vy));
+    *nx = fv_sel(useX, fv_sel(fv_gt(vx, zero), one, mone), zero);
+    *ny = fv_sel(useX, zero, fv_sel(fv_gt(vy, zero), one, mone));
+}
+
+static inline void ResolveCircleVsSquareLanes(const ShapeCompiled *sq, BallLanes *b, fv active){
+    const fv c = fv_set1(sq->c), s = fv_set1(sq->s), ms = fv_set1(-sq->s);
+    const fv zero = fv_set1(0.0f);
+
+    fv wx = fv_sub(b->x, fv_set1(sq->x)), wy = fv_sub(b->y, fv_set1(sq->y));
+    fv pLx = fv_add(fv_mul(c, wx), fv_mul(s, wy));
+    fv pLy = fv_add(fv_mul(ms, wx), fv_mul(c, wy));
+    fv vLx = fv_add(fv_mul(c, b->vx), fv_mul(s, b->vy));
+    fv vLy = fv_add(fv_mul(ms, b->vx), fv_mul(c, b->vy));
+
+    fv h = fv_set1(sq->half), mh = fv_set1(-sq->half);
+    fv dx = fv_sub(pLx, fv_min(fv_max(pLx, mh), h));
+    fv dy = fv_sub(pLy, fv_min(fv_max(pLy, mh), h));
+    fv dist2 = fv_add(fv_mul(dx, dx), fv_mul(dy, dy));
+
+    fv hit = fv_and(active, fv_le(dist2, fv_mul(b->r, b->r)));
+    if (!fv_any(hit)) return;
+
+    fv dist = fv_sel(fv_gt(dist2, zero), fv_sqrt(dist2), zero);
+    fv ax, ay; AxisNormalLanes(vLx, vLy, &ax, &ay);
+    fv far = fv_gt(dist, fv_set1(1.0f));
+    fv nLx = fv_sel(far, fv_div(dx, dist), ax);
+    fv nLy = fv_sel(far, fv_div(dy, dist), ay);
+
+    fv pen = fv_add(fv_sub(b->r, dist), fv_set1(SEP_BIAS));
+    pen = fv_sel(fv_lt(pen, zero), zero, pen);
+    fv nWx = fv_sub(fv_mul(c, nLx), fv_mul(s, nLy));
+    fv nWy = fv_add(fv_mul(s, nLx), fv_mul(c, nLy));
+
+    fv x = fv_add(b->x, fv_mul(nWx, pen)), y = fv_add(b->y, fv_mul(nWy, pen));
+    fv vx = b->vx, vy = b->vy;
+    ReflectOffShapeLanes(sq, x, y, &vx, &vy, nWx, nWy);
+    const fv drift = fv_set1(1.0f/8000.0f);
+    x = fv_add(x, fv_mul(vx, drift)); y = fv_add(y, fv_mul(vy, drift));
+
+    b->x  = fv_sel(hit, x,  b->x);  b->y  = fv_sel(hit, y,  b->y);
+    b->vx = fv_sel(hit, vx, b->vx); b->vy = fv_sel(hit, vy, b->vy);
+}
+
+static inline void ResolveCircleVsCircleLanes(const ShapeCompiled *sc, BallLanes *b, fv active){
+    const fv zero = fv_set1(0.0f);
+    fv dx = fv_sub(b->x, fv_set1(sc->x)), dy = fv_sub(b->y, fv_set1(sc->y));
+    fv rSum = fv_add(b->r, fv_set1(sc->radius));
+    fv d2 = fv_add(fv_mul(dx, dx), fv_mul(dy, dy));
+
+    fv hit = fv_and(active, fv_le(d2, fv_mul(rSum, rSum)));
+    if (!fv_any(hit)) return;
+
+    fv d = fv_sel(fv_gt(d2, zero), fv_sqrt(d2), zero);
+    fv ax, ay; AxisNormalLanes(b->vx, b->vy, &ax, &ay);
+    fv far = fv_gt(d, fv_set1(1.0e-6f));
+    fv nx = fv_sel(far, fv_div(dx, d), ax);
+    fv ny = fv_sel(far, fv_div(dy, d), ay);
+
+    fv pen = fv_add(fv_sub(rSum, d), fv_set1(SEP_BIAS));
+    pen = fv_sel(fv_lt(pen, zero), zero, pen);
+
+    fv x = fv_add(b->x, fv_mul(nx, pen)), y = fv_add(b->y, fv_mul(ny, pen));
+    fv vx = b->vx, vy = b->vy;
+    ReflectOffShapeLanes(sc, x, y, &vx, &vy, nx, ny);
+    const fv drift = fv_set1(1.0f/8000.0f);
+    x = fv_add(x, fv_mul(vx, drift)); y = fv_add(y, fv_mul(vy, drift));
+
+    b->x  = fv_sel(hit, x,  b->x);  b->y  = fv_sel(hit, y,  b->y);
+    b->vx = fv_sel(hit, vx, b->vx); b->vy = fv_sel(hit, vy, b->vy);
+}
+
+// Hull reach test + dispatch, mirroring the scalar loop in the sim phase.
+static inline void ResolveCircleVsShapeLanes(const ShapeCompiled *sh, BallLanes *b, fv active){
+    fv dx = fv_sub(b->x, fv_set1(sh->x)), dy = fv_sub(b->y, fv_set1(sh->y));
+    fv reach = fv_add(fv_set1(sh->hull), b->r);
+    active = fv_and(active, fv_le(fv_add(fv_mul(dx, dx), fv_mul(dy, dy)), fv_mul(reach, reach)));
+    if (!fv_any(active)) return;
+    if (sh->type==SHAPE_SQUARE) ResolveCircleVsSquareLanes(sh, b, active);
+    else                        ResolveCircleVsCircleLanes(sh, b, active);
+}
+
+#endif